@@ -0,0 +1,222 @@
+#include "interop.h"
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+// Mod asset packs, built by the patcher from each mod's assets directory into gmsl/cache/assets/<mod>.pack (see
+// AssetPack.cs for the layout). Every pack is mapped once at startup and stays mapped, so an asset is a binary
+// search on its path hash plus one copy into a GML buffer instead of a file open and read per asset. Pointers
+// from interop_asset_ptr stay valid for the lifetime of the game.
+
+#define ASSETS_MAGIC 0x50414d47 // "GMAP"
+#define ASSETS_VERSION 1
+
+#pragma pack(push, 1)
+struct AssetsHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+    uint64_t fingerprint;
+};
+
+struct AssetsEntry
+{
+    uint64_t hash;
+    uint64_t offset;
+    uint32_t size;
+    uint32_t name;
+};
+#pragma pack(pop)
+
+struct AssetPack
+{
+    FileMapping map;
+    const AssetsEntry* entries;
+    uint32_t count;
+};
+
+static std::unordered_map<std::string, AssetPack> assetPacks;
+
+// fnv-1a over the path with ascii folded to lower case and '\' as '/', AssetPack.cs hashes the same way
+static uint64_t assets_hash(const char* path)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (; *path; path++)
+    {
+        char c = *path == '\\' ? '/' : *path;
+        if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+        hash = (hash ^ (uint8_t)c) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static bool assets_path_equals(const char* a, const char* b)
+{
+    for (;; a++, b++)
+    {
+        char x = *a == '\\' ? '/' : *a;
+        char y = *b == '\\' ? '/' : *b;
+        if (x >= 'A' && x <= 'Z') x += 'a' - 'A';
+        if (y >= 'A' && y <= 'Z') y += 'a' - 'A';
+        if (x != y) return false;
+        if (!x) return true;
+    }
+}
+
+void assets_open(const std::string& mod, const std::filesystem::path& path)
+{
+    AssetPack pack = AssetPack();
+    if (!file_map(path, pack.map))
+    {
+        file_unmap(pack.map);
+        return;
+    }
+
+    AssetsHeader header;
+    if (pack.map.size < sizeof(header))
+    {
+        LOG_ERROR("asset pack " << path.string() << " is truncated");
+        file_unmap(pack.map);
+        return;
+    }
+    std::memcpy(&header, pack.map.data, sizeof(header));
+    if (header.magic != ASSETS_MAGIC || header.version != ASSETS_VERSION)
+    {
+        LOG_ERROR("asset pack " << path.string() << " has an unknown format, delete it to have it rebuilt");
+        file_unmap(pack.map);
+        return;
+    }
+    if ((pack.map.size - sizeof(header)) / sizeof(AssetsEntry) < header.entryCount)
+    {
+        LOG_ERROR("asset pack " << path.string() << " is truncated");
+        file_unmap(pack.map);
+        return;
+    }
+
+    // checked once here so lookups can trust offsets, names are checked to be terminated inside the file too
+    pack.entries = (const AssetsEntry*)(pack.map.data + sizeof(header));
+    pack.count = header.entryCount;
+    for (uint32_t i = 0; i < pack.count; i++)
+    {
+        const AssetsEntry& entry = pack.entries[i];
+        bool valid = entry.offset <= pack.map.size && entry.size <= pack.map.size - entry.offset &&
+                     entry.name < pack.map.size &&
+                     std::memchr(pack.map.data + entry.name, 0, pack.map.size - entry.name) != NULL;
+        if (!valid)
+        {
+            LOG_ERROR("asset pack " << path.string() << " has a bad entry at " << i);
+            file_unmap(pack.map);
+            return;
+        }
+    }
+
+    LOG_INFO("Mapped " << pack.count << " assets for " << mod);
+    assetPacks[mod] = pack;
+}
+
+static const AssetPack* assets_pack(RValue* arg, int index)
+{
+    auto found = assetPacks.find(YYGetString(arg, index));
+    return found != assetPacks.end() ? &found->second : NULL;
+}
+
+static const AssetsEntry* assets_find(const AssetPack* pack, const char* path)
+{
+    if (!pack) return NULL;
+
+    uint64_t hash = assets_hash(path);
+    const AssetsEntry* end = pack->entries + pack->count;
+    const AssetsEntry* entry = std::lower_bound(pack->entries, end, hash,
+        [](const AssetsEntry& entry, uint64_t hash) { return entry.hash < hash; });
+    for (; entry != end && entry->hash == hash; entry++)
+    {
+        if (assets_path_equals((const char*)pack->map.data + entry->name, path)) return entry;
+    }
+    return NULL;
+}
+
+static const AssetsEntry* assets_find(RValue* arg)
+{
+    return assets_find(assets_pack(arg, 0), YYGetString(arg, 1));
+}
+
+// interop_asset_exists(mod, path)
+YYEXPORT void interop_asset_exists(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    Result.kind = VALUE_REAL;
+    Result.val = assets_find(arg) != NULL;
+}
+
+// interop_asset_size(mod, path), -1 when the asset doesn't exist
+YYEXPORT void interop_asset_size(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    const AssetsEntry* entry = assets_find(arg);
+    Result.kind = VALUE_REAL;
+    Result.val = entry ? (double)entry->size : -1;
+}
+
+// interop_asset_load(mod, path, [buffer], [offset]), copies the asset into buffer at offset (growing it if it's a
+// grow buffer) and returns the bytes written, or into a new fixed buffer and returns that. -1 on failure
+YYEXPORT void interop_asset_load(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    Result.kind = VALUE_REAL;
+    Result.val = -1;
+
+    const AssetPack* pack = assets_pack(arg, 0);
+    const char* path = YYGetString(arg, 1);
+    const AssetsEntry* entry = assets_find(pack, path);
+    if (!entry)
+    {
+        LOG_WARN("No asset " << path << " in " << YYGetString(arg, 0));
+        return;
+    }
+    if (entry->size > INT32_MAX)
+    {
+        LOG_ERROR("Asset " << path << " is too big for a buffer");
+        return;
+    }
+
+    const void* data = pack->map.data + entry->offset;
+    if (argc > 2)
+    {
+        int buffer = YYGetInt32(arg, 2);
+        int offset = argc > 3 ? YYGetInt32(arg, 3) : 0;
+        Result.val = BufferWriteContent(buffer, offset, data, (int)entry->size, true);
+        return;
+    }
+
+    // buffer_create doesn't take 0
+    int buffer = CreateBuffer(std::max<int>((int)entry->size, 1), eBuffer_Format_Fixed, 1);
+    if (buffer < 0) return;
+    BufferWriteContent(buffer, 0, data, (int)entry->size);
+    Result.val = buffer;
+}
+
+// interop_asset_ptr(mod, path), the asset's address inside the mapping for extensions and mods that read memory
+// directly, pointer 0 when the asset doesn't exist. Read only
+YYEXPORT void interop_asset_ptr(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    const AssetPack* pack = assets_pack(arg, 0);
+    const AssetsEntry* entry = assets_find(pack, YYGetString(arg, 1));
+    Result.kind = VALUE_PTR;
+    Result.ptr = entry ? (void*)(pack->map.data + entry->offset) : NULL;
+}
+
+// interop_asset_count(mod)
+YYEXPORT void interop_asset_count(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    const AssetPack* pack = assets_pack(arg, 0);
+    Result.kind = VALUE_REAL;
+    Result.val = pack ? pack->count : 0;
+}
+
+// interop_asset_name(mod, index), paths are relative to the mod's assets directory and '/' separated, in pack
+// order which isn't alphabetical
+YYEXPORT void interop_asset_name(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    const AssetPack* pack = assets_pack(arg, 0);
+    uint32_t index = (uint32_t)YYGetInt32(arg, 1);
+    YYCreateString(&Result, pack && index < pack->count ? (const char*)pack->map.data + pack->entries[index].name : "");
+}
@@ -0,0 +1,134 @@
+#include "interop.h"
+#include <mono/metadata/metadata.h>
+#include <mono/metadata/loader.h>
+#include <cstdint>
+
+// Methods whose parameters and return type are all blittable get called straight through their unmanaged thunk
+// instead of mono_runtime_invoke, so there's no boxing, no void* argument array and no reflection on the way.
+// The thunk takes the managed arguments followed by a MonoException**, and since int, bool and IntPtr all travel
+// in general purpose registers on x64 they're passed as intptr_t, which keeps this at three register classes.
+
+static bool fastcall_kind(MonoType* type, FastKind& kind)
+{
+    switch (mono_type_get_type(type))
+    {
+        case MONO_TYPE_VOID: kind = FastKind::Void; return true;
+        case MONO_TYPE_R8: kind = FastKind::Double; return true;
+        case MONO_TYPE_R4: kind = FastKind::Single; return true;
+        case MONO_TYPE_I4: kind = FastKind::Int32; return true;
+        case MONO_TYPE_I8: kind = FastKind::Int64; return true;
+        case MONO_TYPE_BOOLEAN: kind = FastKind::Boolean; return true;
+        case MONO_TYPE_I: kind = FastKind::IntPtr; return true;
+        default: return false;
+    }
+}
+
+bool fastcall_bind(FastCall& call, MonoMethod* method)
+{
+#if INTPTR_MAX != INT64_MAX
+    return false;
+#else
+    MonoMethodSignature* sig = mono_method_signature(method);
+    if (mono_signature_is_instance(sig)) return false;
+
+    int argc = (int)mono_signature_get_param_count(sig);
+    if (argc > FASTCALL_MAX_ARGS) return false;
+
+    if (!fastcall_kind(mono_signature_get_return_type(sig), call.ret)) return false;
+
+    void* iter = NULL;
+    for (int i = 0; i < argc; i++)
+    {
+        MonoType* type = mono_signature_get_params(sig, &iter);
+        if (!type || !fastcall_kind(type, call.params[i]) || call.params[i] == FastKind::Void) return false;
+    }
+
+    call.argc = argc;
+    call.thunk = mono_method_get_unmanaged_thunk(method);
+    return call.thunk != NULL;
+#endif
+}
+
+template <typename R, typename... A>
+static R fastcall_call(const FastCall& call, MonoObject** exception, A... args)
+{
+    return ((R(*)(A..., MonoObject**))call.thunk)(args..., exception);
+}
+
+// picks the thunk's C signature one argument at a time from the bound kinds
+template <typename R, typename... A>
+static R fastcall_dispatch(const FastCall& call, RValue* arg, MonoObject** exception, A... args)
+{
+    constexpr int index = sizeof...(A);
+    if (index == call.argc) return fastcall_call<R, A...>(call, exception, args...);
+
+    if constexpr (index < FASTCALL_MAX_ARGS)
+    {
+        switch (call.params[index])
+        {
+            case FastKind::Double:
+                return fastcall_dispatch<R, A..., double>(call, arg, exception, args..., YYGetReal(arg, index));
+            case FastKind::Single:
+                return fastcall_dispatch<R, A..., float>(call, arg, exception, args..., YYGetFloat(arg, index));
+            case FastKind::Int32:
+                return fastcall_dispatch<R, A..., intptr_t>(call, arg, exception, args..., (intptr_t)YYGetInt32(arg, index));
+            case FastKind::Int64:
+                return fastcall_dispatch<R, A..., intptr_t>(call, arg, exception, args..., (intptr_t)YYGetInt64(arg, index));
+            case FastKind::Boolean:
+                return fastcall_dispatch<R, A..., intptr_t>(call, arg, exception, args..., (intptr_t)YYGetBool(arg, index));
+            case FastKind::IntPtr:
+                return fastcall_dispatch<R, A..., intptr_t>(call, arg, exception, args..., YYGetPtrOrInt(arg, index));
+            default:
+                break;
+        }
+    }
+    return R();
+}
+
+MonoObject* fastcall_invoke(const FastCall& call, RValue& Result, RValue* arg)
+{
+    MonoObject* exception = NULL;
+    switch (call.ret)
+    {
+        case FastKind::Double:
+            Result.kind = VALUE_REAL;
+            Result.val = fastcall_dispatch<double>(call, arg, &exception);
+            break;
+
+        case FastKind::Single:
+            Result.kind = VALUE_REAL;
+            Result.val = fastcall_dispatch<float>(call, arg, &exception);
+            break;
+
+        default:
+        {
+            // only the low bits of the register are defined for the narrower return types
+            intptr_t value = fastcall_dispatch<intptr_t>(call, arg, &exception);
+            switch (call.ret)
+            {
+                case FastKind::Void:
+                    Result.kind = VALUE_UNDEFINED;
+                    Result.v64 = 0;
+                    break;
+                case FastKind::Int32:
+                    Result.kind = VALUE_REAL;
+                    Result.val = (int32_t)value;
+                    break;
+                case FastKind::Boolean:
+                    Result.kind = VALUE_REAL;
+                    Result.val = (uint8_t)value != 0;
+                    break;
+                case FastKind::IntPtr:
+                    Result.kind = VALUE_PTR;
+                    Result.ptr = (void*)value;
+                    break;
+                default:
+                    Result.kind = VALUE_REAL;
+                    Result.val = (double)(int64_t)value;
+                    break;
+            }
+            break;
+        }
+    }
+    return exception;
+}
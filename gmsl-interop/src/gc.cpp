@@ -0,0 +1,163 @@
+#include "interop.h"
+#include <mono/metadata/profiler.h>
+#include <mono/metadata/mono-gc.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+// GC tuning and telemetry. gmsl/interop/gc.cfg is turned into MONO_GC_PARAMS before mono_jit_init_version, and
+// the profiler gc event hooks record how long the world was stopped so hitches can be pinned on the GC.
+
+struct _MonoProfiler
+{
+    int unused;
+};
+
+static MonoProfiler gcProfiler;
+static bool gcAllocTelemetry = false;
+static int64 gcPauseLogUs = 0;
+
+static std::atomic<int64> gcPauseStart(0);
+static std::atomic<int64> gcPauseLast(0);
+static std::atomic<int64> gcPauseMax(0);
+static std::atomic<int64> gcPauseTotal(0);
+static std::atomic<int64> gcFramePause(0);
+static std::atomic<int64> gcFrameBytes(0);
+static std::atomic<uint32> gcFrameCollections(0);
+static std::atomic<uint32> gcCollections[2];
+
+// last finished frame
+static int64 gcLastFramePause = 0;
+static int64 gcLastFrameBytes = 0;
+static uint32 gcLastFrameCollections = 0;
+static uint64 gcFrames = 0;
+
+static int64 gc_now()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void gc_event(MonoProfiler* profiler, MonoProfilerGCEvent event, uint32_t generation, mono_bool is_serial)
+{
+    switch (event)
+    {
+        case MONO_GC_EVENT_START:
+            gcCollections[generation == 0 ? 0 : 1]++;
+            gcFrameCollections++;
+            break;
+
+        case MONO_GC_EVENT_PRE_STOP_WORLD:
+            gcPauseStart = gc_now();
+            break;
+
+        case MONO_GC_EVENT_POST_START_WORLD:
+        {
+            int64 pause = gc_now() - gcPauseStart;
+            gcPauseLast = pause;
+            gcPauseTotal += pause;
+            gcFramePause += pause;
+            if (pause > gcPauseMax) gcPauseMax = pause;
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+static void gc_allocation(MonoProfiler* profiler, MonoObject* object)
+{
+    gcFrameBytes += mono_object_get_size(object);
+}
+
+static std::string gc_trim(const std::string& str)
+{
+    size_t start = str.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos) return "";
+    size_t end = str.find_last_not_of(" \t\r\n");
+    return str.substr(start, end - start + 1);
+}
+
+void gc_configure(const std::filesystem::path& config)
+{
+    std::string params;
+    std::ifstream file(config);
+    std::string line;
+    while (std::getline(file, line))
+    {
+        line = gc_trim(line);
+        if (line.empty() || line[0] == '#') continue;
+
+        if (line.rfind("gmsl.", 0) == 0)
+        {
+            size_t eq = line.find('=');
+            std::string key = gc_trim(line.substr(5, eq == std::string::npos ? std::string::npos : eq - 5));
+            std::string value = eq == std::string::npos ? "" : gc_trim(line.substr(eq + 1));
+            if (key == "alloc-telemetry") gcAllocTelemetry = value == "true" || value == "1";
+            else if (key == "pause-log-us") gcPauseLogUs = std::atoll(value.c_str());
+            else LOG_WARN("Unknown gc.cfg option: " << line);
+            continue;
+        }
+
+        if (!params.empty()) params += ",";
+        params += line;
+    }
+
+    // anything already in the environment wins, sgen uses the last value it sees for an option
+    if (const char* existing = std::getenv("MONO_GC_PARAMS"))
+    {
+        if (*existing) params += std::string(params.empty() ? "" : ",") + existing;
+    }
+
+    if (!params.empty())
+    {
+        LOG_INFO("MONO_GC_PARAMS=" << params);
+#ifdef OS_Windows
+        _putenv_s("MONO_GC_PARAMS", params.c_str());
+#else
+        setenv("MONO_GC_PARAMS", params.c_str(), 1);
+#endif
+    }
+
+    MonoProfilerHandle handle = mono_profiler_create(&gcProfiler);
+    mono_profiler_set_gc_event_callback(handle, gc_event);
+    if (gcAllocTelemetry && mono_profiler_enable_allocations())
+        mono_profiler_set_gc_allocation_callback(handle, gc_allocation);
+}
+
+void gc_frame()
+{
+    gcFrames++;
+    gcLastFramePause = gcFramePause.exchange(0);
+    gcLastFrameBytes = gcFrameBytes.exchange(0);
+    gcLastFrameCollections = gcFrameCollections.exchange(0);
+
+    if (gcPauseLogUs > 0 && gcLastFramePause > gcPauseLogUs)
+    {
+        LOG_WARN("GC hitch on frame " << gcFrames << ": " << gcLastFrameCollections << " collection(s), "
+                 << gcLastFramePause << "us paused"
+                 << (gcAllocTelemetry ? ", " + std::to_string(gcLastFrameBytes) + " bytes allocated" : ""));
+    }
+}
+
+// interop_gc_stat(name) with one of the names below, times are in microseconds
+YYEXPORT void interop_gc_stat(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    Result.kind = VALUE_REAL;
+    Result.val = 0;
+
+    const char* stat = YYGetString(arg, 0);
+    if (std::strcmp(stat, "pause_last") == 0) Result.val = (double)gcPauseLast;
+    else if (std::strcmp(stat, "pause_max") == 0) Result.val = (double)gcPauseMax;
+    else if (std::strcmp(stat, "pause_total") == 0) Result.val = (double)gcPauseTotal;
+    else if (std::strcmp(stat, "frame_pause") == 0) Result.val = (double)gcLastFramePause;
+    else if (std::strcmp(stat, "frame_bytes") == 0) Result.val = (double)gcLastFrameBytes;
+    else if (std::strcmp(stat, "frame_collections") == 0) Result.val = (double)gcLastFrameCollections;
+    else if (std::strcmp(stat, "collections_minor") == 0) Result.val = (double)gcCollections[0];
+    else if (std::strcmp(stat, "collections_major") == 0) Result.val = (double)gcCollections[1];
+    else if (std::strcmp(stat, "heap_used") == 0) Result.val = (double)mono_gc_get_used_size();
+    else if (std::strcmp(stat, "heap_size") == 0) Result.val = (double)mono_gc_get_heap_size();
+    else LOG_WARN("Unknown gc stat: " << stat);
+}
@@ -1,78 +1,152 @@
-#include "extensions/Extension_Interface.h"
-#include "extensions/YYRValue.h"
-#include <iostream>
+#include "interop.h"
 #include "intrin.h"
 #include <mono/jit/jit.h>
 #include <mono/metadata/assembly.h>
 #include <mono/metadata/debug-helpers.h>
 #include <filesystem>
 #include <map>
+#include <unordered_map>
 #include <cstring>
-
-struct CurrentInterop
-{
-    std::string dll;
-    std::string ns;
-    std::string clazz;
-    std::string function;
-    int argc;
-};
+#include <algorithm>
 
 YYRunnerInterface gs_runnerInterface;
 YYRunnerInterface* g_pYYRunnerInterface;
 CurrentInterop currentInterop;
+InteropBinding* currentBinding;
+std::unordered_map<std::string, InteropBinding> bindings;
+std::unordered_map<std::string, uint64> exceptionCounts;
 std::map<std::string, MonoImage*> mods;
 MonoDomain *domain;
 
+// GMSL.Logger.Logger, its LogLevel starts at Info
+static void interop_log_native(int level, MonoString* message)
+{
+    if (!log_enabled((LogLevel)(level + 1))) return;
+    char* str = mono_string_to_utf8(message);
+    log_write((LogLevel)(level + 1), str, std::strlen(str));
+    mono_free(str);
+}
+
 YYEXPORT void YYExtensionInitialise(const struct YYRunnerInterface* _pFunctions, size_t _functions_size)
 {
 	memcpy(&gs_runnerInterface, _pFunctions, sizeof(YYRunnerInterface));
+	log_init("gmsl/logs/interop.log");
 	g_pYYRunnerInterface = &gs_runnerInterface;
 	
 	if (_functions_size < sizeof(YYRunnerInterface)) {
-		std::cout << "[VSLoader] ERROR : runner interface mismatch in extension DLL" << std::endl;
+		LOG_ERROR("runner interface mismatch in extension DLL");
 	}
 	
-	std::cout << "[VSLoader] YYExtensionInitialise CONFIGURED" << std::endl;
+	LOG_INFO("YYExtensionInitialise CONFIGURED");
 
-    std::cout << "[VSLoader] Loading mods for interop..." << std::endl;
+    LOG_INFO("Loading mods for interop...");
     mono_set_assemblies_path("gmsl/interop/lib");
+    gc_configure("gmsl/interop/gc.cfg");
     domain = mono_jit_init_version("gmsl", "v4.0.30319");
+    mono_add_internal_call("GMSL.Logger.Logger::WriteNative", (const void*)interop_log_native);
+    tick_init();
+    scheduler_init();
+    kv_init();
     std::filesystem::path directoryPath("gmsl/mods");
 
     for (const auto& entry : std::filesystem::directory_iterator(directoryPath)) {
         if (std::filesystem::is_directory(entry)) {
             std::filesystem::path fn = entry.path().filename();
             std::filesystem::path modpath = directoryPath / fn / (fn.string() + ".dll");
-            std::cout << modpath << std::endl;
+            LOG_INFO(modpath);
+            // a mod can be native code and assets only, those don't need its assembly
+            plugins_load(fn.string(), directoryPath / fn);
+            assets_open(fn.string(), std::filesystem::path("gmsl/cache/assets") / (fn.string() + ".pack"));
 	    if (!std::filesystem::exists(modpath)) continue;
             MonoAssembly *assembly = mono_domain_assembly_open(domain, modpath.string().c_str());
             MonoImage *image = mono_assembly_get_image(assembly);
             mods[fn.string()] = image;
+            tick_discover(image, fn.string());
         }
     }
+
+    manifest_load("cache.interop");
+    trace_init();
+}
+
+// resolving the class and method by name is far more expensive than the call itself, so it's done once per target
+static InteropBinding* interop_bind()
+{
+    std::string key = currentInterop.dll + '/' + currentInterop.ns + '/' + currentInterop.clazz + '/' + currentInterop.function + '/' + std::to_string(currentInterop.argc);
+    auto found = bindings.find(key);
+    if (found != bindings.end()) return &found->second;
+
+    InteropBinding binding = InteropBinding();
+    binding.name = currentInterop.function;
+    auto image = mods.find(currentInterop.dll);
+    MonoClass* klass = image != mods.end() ? mono_class_from_name(image->second, currentInterop.ns.c_str(), currentInterop.clazz.c_str()) : NULL;
+//    MonoObject* instance = mono_object_new(domain, klass);
+//    mono_runtime_object_init(instance);
+    binding.method = klass ? mono_class_get_method_from_name(klass, currentInterop.function.c_str(), currentInterop.argc) : NULL;
+    if (!binding.method)
+    {
+        LOG_ERROR("can't find interop method " << currentInterop.ns << "." << currentInterop.clazz << "." << currentInterop.function << " in " << currentInterop.dll);
+    }
+    else
+    {
+        binding.fast = fastcall_bind(binding.fastCall, binding.method);
+    }
+    return &bindings.emplace(key, binding).first->second;
 }
 
 YYEXPORT void interop_set_function(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
 {
     Result.kind = VALUE_REAL;
     Result.val = 1;
-    currentInterop = CurrentInterop();
     currentInterop.dll = arg[0].GetString();
     currentInterop.ns = arg[1].GetString();
     currentInterop.clazz = arg[2].GetString();
     currentInterop.function = arg[3].GetString();
     currentInterop.argc = arg[4].val;
+    currentBinding = interop_bind();
 }
 
-YYEXPORT void interop_function(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+// the full ToString (type, message and stack trace) is only built the first time a function throws, after that
+// repeats are logged by type with a running count so an exception every frame doesn't flood the log
+void interop_print_exception(MonoObject* exception, const std::string& function)
 {
-    MonoImage *image = mods[currentInterop.dll];
-    MonoClass* klass = mono_class_from_name(image, currentInterop.ns.c_str(), currentInterop.clazz.c_str());
-//    MonoObject* instance = mono_object_new(domain, klass);
-//    mono_runtime_object_init(instance);
-    MonoMethod* method = mono_class_get_method_from_name(klass, currentInterop.function.c_str(), currentInterop.argc);
-    void** args = new void*[currentInterop.argc];
+    uint64 count = ++exceptionCounts[function];
+    if (count == 1)
+    {
+        MonoString* message = (MonoString*)mono_object_to_string(exception, NULL);
+        char* str = message ? mono_string_to_utf8(message) : NULL;
+        LOG_ERROR("Exception thrown in c# while calling " << function << "\n" << (str ? str : mono_class_get_name(mono_object_get_class(exception))));
+        mono_free(str);
+    }
+    else if ((count & (count - 1)) == 0)
+    {
+        LOG_ERROR(mono_class_get_name(mono_object_get_class(exception)) << " thrown in c# while calling " << function << " (" << count << " times)");
+    }
+}
+
+// returns false when the call threw or its arguments / result couldn't be converted
+static bool interop_invoke(InteropBinding* binding, RValue& Result, int argc, RValue* arg)
+{
+    if (!binding || !binding->method)
+    {
+        YYCreateString(&Result, "INTEROP ERROR");
+        return false;
+    }
+
+    if (binding->fast && argc == binding->fastCall.argc)
+    {
+        MonoObject* exception = fastcall_invoke(binding->fastCall, Result, arg);
+        if (exception)
+        {
+            interop_print_exception(exception, binding->name);
+            YYCreateString(&Result, "INTEROP ERROR");
+            return false;
+        }
+        return true;
+    }
+
+    MonoMethod* method = binding->method;
+    void** args = new void*[argc];
     RValue elem;
 
     for (int i = 0; i < argc; i++)
@@ -89,8 +163,9 @@ YYEXPORT void interop_function(RValue& Result, CInstance* selfinst, CInstance* o
                 break;
 
             default:
-                std::cout << "Unknown value type: " << elem.kind;
-                return;
+                LOG_ERROR("Unknown value type: " << elem.kind);
+                delete[] args;
+                return false;
 
             // This has to be at the bottom for some reason idfk why
             case VALUE_STRING:
@@ -100,24 +175,16 @@ YYEXPORT void interop_function(RValue& Result, CInstance* selfinst, CInstance* o
         }
     }
 
+    bool ok = true;
     MonoObject *exception;
     exception = NULL;
     MonoObject* returnValue = mono_runtime_invoke(method, NULL, args, &exception);
     if (exception) {
-        std::cout << "Exception thrown in c# while calling " << currentInterop.function << std::endl;
-        MonoClass* pClass = mono_object_get_class(exception);
-        void* iter = NULL;
-        while (MonoClassField* field = mono_class_get_fields(pClass, &iter)) {
-            const char* fieldName = mono_field_get_name(field);
-            std::cout << "Field Name: " << fieldName << std::endl;
-            MonoString* trace;
-            mono_field_get_value(exception, field, &trace);
-            if (!trace) continue;
-            std::cout << mono_string_to_utf8(trace) << std::endl;
-        }
+        interop_print_exception(exception, binding->name);
 
         // std::cin.get(); // freeze the program to signify something is wrong
         YYCreateString(&Result, "INTEROP ERROR");
+        ok = false;
     }
     else {
         MonoClass* classPtr = mono_object_get_class(returnValue);
@@ -144,9 +211,47 @@ YYEXPORT void interop_function(RValue& Result, CInstance* selfinst, CInstance* o
         }
         else
         {
-            std::cout << "Cant Convert Type Name: " << typeName << std::endl;
+            LOG_ERROR("Cant Convert Type Name: " << typeName);
             YYCreateString(&Result, "INTEROP ERROR");
+            ok = false;
         }
     }
     delete[] args;
+    return ok;
+}
+
+YYEXPORT void interop_function(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    InteropBinding* binding = currentBinding;
+    if (!traceActive)
+    {
+        interop_invoke(binding, Result, argc, arg);
+        return;
+    }
+
+    uint64_t start = trace_now();
+    bool ok = interop_invoke(binding, Result, argc, arg);
+    trace_call(binding, argc, arg, start, trace_now(), !ok);
+}
+
+// interop_log(level, message) with level 0 debug, 1 info, 2 warning, 3 error
+YYEXPORT void interop_log(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    Result.kind = VALUE_REAL;
+    Result.val = 0;
+
+    int level = YYGetInt32(arg, 0);
+    if (level < (int)LogLevel::Debug || level > (int)LogLevel::Error || !log_enabled((LogLevel)level)) return;
+    const char* message = YYGetString(arg, 1);
+    log_write((LogLevel)level, message, std::strlen(message));
+    Result.val = 1;
+}
+
+// interop_log_level(level), anything below level is discarded before it reaches the log thread, 4 turns logging off
+YYEXPORT void interop_log_level(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    int level = YYGetInt32(arg, 0);
+    log_set_level((LogLevel)std::min(std::max(level, (int)LogLevel::Debug), (int)LogLevel::None));
+    Result.kind = VALUE_REAL;
+    Result.val = 1;
 }
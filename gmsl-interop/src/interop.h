@@ -0,0 +1,104 @@
+#pragma once
+
+#include "extensions/Extension_Interface.h"
+#include "extensions/YYRValue.h"
+#include <mono/jit/jit.h>
+#include "gmsl-log.h"
+#include <filesystem>
+#include <map>
+#include <string>
+
+struct CurrentInterop
+{
+    std::string dll;
+    std::string ns;
+    std::string clazz;
+    std::string function;
+    int argc;
+};
+
+#define FASTCALL_MAX_ARGS 4
+
+enum class FastKind : uint8_t
+{
+    Void,
+    Double,
+    Single,
+    Int32,
+    Int64,
+    Boolean,
+    IntPtr
+};
+
+struct FastCall
+{
+    void* thunk;
+    int argc;
+    FastKind ret;
+    FastKind params[FASTCALL_MAX_ARGS];
+};
+
+struct InteropBinding
+{
+    MonoMethod* method;
+    std::string name;
+    bool fast;
+    FastCall fastCall;
+};
+
+extern YYRunnerInterface gs_runnerInterface;
+extern CurrentInterop currentInterop;
+extern InteropBinding* currentBinding;
+extern std::map<std::string, MonoImage*> mods;
+extern MonoDomain *domain;
+
+void interop_print_exception(MonoObject* exception, const std::string& function);
+
+// assets.cpp
+void assets_open(const std::string& mod, const std::filesystem::path& path);
+
+// fastcall.cpp
+bool fastcall_bind(FastCall& call, MonoMethod* method);
+MonoObject* fastcall_invoke(const FastCall& call, RValue& Result, RValue* arg);
+
+// gc.cpp
+void gc_configure(const std::filesystem::path& config);
+void gc_frame();
+
+// kvstore.cpp
+void kv_init();
+void kv_collect();
+
+// mapping.cpp
+struct FileMapping
+{
+    const uint8_t* data = NULL;
+    size_t size = 0;
+    void* file = NULL;    // HANDLEs on windows, unused elsewhere
+    void* mapping = NULL;
+};
+
+bool file_map(const std::filesystem::path& path, FileMapping& map);
+void file_unmap(FileMapping& map);
+
+// manifest.cpp
+void manifest_load(const std::filesystem::path& path);
+
+// plugins.cpp
+void plugins_load(const std::string& mod, const std::filesystem::path& directory);
+
+// scheduler.cpp
+void scheduler_init();
+void scheduler_run();
+
+// trace.cpp
+extern bool traceActive;
+uint64_t trace_now();
+void trace_init();
+bool trace_start(const std::string& path);
+void trace_stop();
+void trace_call(const InteropBinding* binding, int argc, RValue* arg, uint64_t start, uint64_t end, bool failed);
+
+// tick.cpp
+void tick_init();
+void tick_discover(MonoImage* image, const std::string& mod);
@@ -0,0 +1,429 @@
+#include "interop.h"
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+// Native key-value store shared between GML and C#. Keys are interned once into stable KvKey pointers, so a lookup
+// with a cached key (interop_kv_key / GMSL.KeyValue.Key) is just a pointer hash and probe. GML gets a key id instead
+// of the pointer, an index into the key table that's checked before use. Both tables are fixed size open addressing
+// and keys are never removed from them, which keeps probing lock-free. Slot values sit behind a per-slot seqlock:
+// readers never block, writers take one of a set of striped locks.
+
+#define KV_CAPACITY (1 << 16)
+#define KV_STRIPES 64
+// replaced strings waiting to be freed before a write tries to free them instead of leaving it to the frame's collect
+#define KV_RETIRE_THRESHOLD 256
+
+enum KvKind : uint8_t
+{
+    KV_NONE = 0,
+    KV_REAL = 1,
+    KV_INT64 = 2,
+    KV_STRING = 3
+};
+
+struct KvKey
+{
+    std::string name;
+    uint64 hash;
+    uint32_t id;
+};
+
+struct KvSlot
+{
+    std::atomic<const KvKey*> key;
+    std::atomic<uint32_t> seq;
+    std::atomic<uint8_t> kind;
+    std::atomic<uint64> bits;
+};
+
+struct KvValue
+{
+    KvKind kind;
+    uint64 bits;
+};
+
+static std::atomic<KvKey*> kvKeys[KV_CAPACITY];
+static std::atomic<KvKey*> kvKeyIds[KV_CAPACITY];
+static std::atomic<uint32_t> kvKeyCount(0);
+static KvSlot kvSlots[KV_CAPACITY];
+static std::mutex kvInsertMutex;
+static std::mutex kvStripes[KV_STRIPES];
+
+// strings replaced while a reader might still be copying them are freed at the end of the frame instead
+static std::atomic<int> kvStringReaders(0);
+static std::mutex kvRetiredMutex;
+static std::vector<std::string*> kvRetired;
+
+static uint64 kv_hash_string(const char* str)
+{
+    uint64 hash = 14695981039346656037ull;
+    for (; *str; str++)
+    {
+        hash ^= (unsigned char)*str;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static uint64 kv_hash_pointer(const KvKey* key)
+{
+    uint64 hash = (uint64)(uintptr_t)key;
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+const KvKey* kv_intern(const char* name)
+{
+    uint64 hash = kv_hash_string(name);
+    for (size_t i = 0; i < KV_CAPACITY; i++)
+    {
+        KvKey* key = kvKeys[(hash + i) & (KV_CAPACITY - 1)].load(std::memory_order_acquire);
+        if (!key) break;
+        if (key->hash == hash && key->name == name) return key;
+    }
+
+    std::lock_guard<std::mutex> lock(kvInsertMutex);
+    for (size_t i = 0; i < KV_CAPACITY; i++)
+    {
+        std::atomic<KvKey*>& slot = kvKeys[(hash + i) & (KV_CAPACITY - 1)];
+        KvKey* key = slot.load(std::memory_order_acquire);
+        if (key)
+        {
+            if (key->hash == hash && key->name == name) return key;
+            continue;
+        }
+
+        uint32_t id = kvKeyCount.load(std::memory_order_relaxed);
+        key = new KvKey{ name, hash, id };
+        kvKeyIds[id].store(key, std::memory_order_release);
+        kvKeyCount.store(id + 1, std::memory_order_release);
+        slot.store(key, std::memory_order_release);
+        return key;
+    }
+
+    LOG_ERROR("key-value store is out of keys");
+    return NULL;
+}
+
+static KvSlot* kv_find(const KvKey* key)
+{
+    uint64 hash = kv_hash_pointer(key);
+    for (size_t i = 0; i < KV_CAPACITY; i++)
+    {
+        KvSlot& slot = kvSlots[(hash + i) & (KV_CAPACITY - 1)];
+        const KvKey* slotKey = slot.key.load(std::memory_order_acquire);
+        if (slotKey == key) return &slot;
+        if (!slotKey) return NULL;
+    }
+    return NULL;
+}
+
+static KvSlot* kv_find_or_insert(const KvKey* key)
+{
+    if (KvSlot* slot = kv_find(key)) return slot;
+
+    std::lock_guard<std::mutex> lock(kvInsertMutex);
+    uint64 hash = kv_hash_pointer(key);
+    for (size_t i = 0; i < KV_CAPACITY; i++)
+    {
+        KvSlot& slot = kvSlots[(hash + i) & (KV_CAPACITY - 1)];
+        const KvKey* slotKey = slot.key.load(std::memory_order_acquire);
+        if (slotKey == key) return &slot;
+        if (slotKey) continue;
+
+        slot.key.store(key, std::memory_order_release);
+        return &slot;
+    }
+
+    LOG_ERROR("key-value store is full");
+    return NULL;
+}
+
+static bool kv_read(const KvSlot* slot, KvValue& value)
+{
+    if (!slot) return false;
+    while (true)
+    {
+        uint32_t before = slot->seq.load(std::memory_order_acquire);
+        if (before & 1) continue;
+        value.kind = (KvKind)slot->kind.load(std::memory_order_relaxed);
+        value.bits = slot->bits.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot->seq.load(std::memory_order_relaxed) == before) return value.kind != KV_NONE;
+    }
+}
+
+static void kv_write(const KvKey* key, KvKind kind, uint64 bits)
+{
+    KvSlot* slot = kind == KV_NONE ? kv_find(key) : kv_find_or_insert(key);
+    if (!slot)
+    {
+        if (kind == KV_STRING) delete (std::string*)(uintptr_t)bits;
+        return;
+    }
+
+    std::string* retired = NULL;
+    {
+        std::lock_guard<std::mutex> lock(kvStripes[(slot - kvSlots) % KV_STRIPES]);
+        uint32_t seq = slot->seq.load(std::memory_order_relaxed);
+        slot->seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        if (slot->kind.load(std::memory_order_relaxed) == KV_STRING)
+            retired = (std::string*)(uintptr_t)slot->bits.load(std::memory_order_relaxed);
+        slot->kind.store(kind, std::memory_order_relaxed);
+        slot->bits.store(bits, std::memory_order_relaxed);
+
+        slot->seq.store(seq + 2, std::memory_order_release);
+    }
+
+    if (retired)
+    {
+        size_t pending;
+        {
+            std::lock_guard<std::mutex> lock(kvRetiredMutex);
+            kvRetired.push_back(retired);
+            pending = kvRetired.size();
+        }
+        if (pending >= KV_RETIRE_THRESHOLD) kv_collect();
+    }
+}
+
+static void kv_set_real(const KvKey* key, double value)
+{
+    uint64 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    kv_write(key, KV_REAL, bits);
+}
+
+static void kv_set_int64(const KvKey* key, int64 value)
+{
+    kv_write(key, KV_INT64, (uint64)value);
+}
+
+static void kv_set_string(const KvKey* key, const char* value)
+{
+    kv_write(key, KV_STRING, (uint64)(uintptr_t)new std::string(value));
+}
+
+static double kv_real(const KvValue& value)
+{
+    if (value.kind == KV_INT64) return (double)(int64)value.bits;
+    double real;
+    std::memcpy(&real, &value.bits, sizeof(real));
+    return real;
+}
+
+// reads a string value and hands it to use() while it's guaranteed to stay alive
+template <typename F>
+static bool kv_with_string(const KvKey* key, F use)
+{
+    kvStringReaders.fetch_add(1, std::memory_order_seq_cst);
+    KvValue value;
+    bool found = kv_read(kv_find(key), value) && value.kind == KV_STRING;
+    if (found) use(*(const std::string*)(uintptr_t)value.bits);
+    kvStringReaders.fetch_sub(1, std::memory_order_seq_cst);
+    return found;
+}
+
+void kv_collect()
+{
+    std::vector<std::string*> retired;
+    {
+        std::lock_guard<std::mutex> lock(kvRetiredMutex);
+        if (kvRetired.empty()) return;
+        retired.swap(kvRetired);
+    }
+
+    // anything retired is already out of its slot, so once no reader is active nobody can still be holding it
+    if (kvStringReaders.load(std::memory_order_seq_cst) != 0)
+    {
+        std::lock_guard<std::mutex> lock(kvRetiredMutex);
+        kvRetired.insert(kvRetired.end(), retired.begin(), retired.end());
+        return;
+    }
+
+    for (std::string* str : retired) delete str;
+}
+
+// internal calls for GMSL.KeyValue
+
+static void* kv_key_native(MonoString* name)
+{
+    char* str = mono_string_to_utf8(name);
+    const KvKey* key = kv_intern(str);
+    mono_free(str);
+    return (void*)key;
+}
+
+static MonoBoolean kv_try_get_double_native(void* key, double* result)
+{
+    KvValue value;
+    if (!key || !kv_read(kv_find((const KvKey*)key), value) || value.kind == KV_STRING) return false;
+    *result = kv_real(value);
+    return true;
+}
+
+static MonoBoolean kv_try_get_long_native(void* key, int64* result)
+{
+    KvValue value;
+    if (!key || !kv_read(kv_find((const KvKey*)key), value) || value.kind == KV_STRING) return false;
+    *result = value.kind == KV_INT64 ? (int64)value.bits : (int64)kv_real(value);
+    return true;
+}
+
+static MonoString* kv_get_string_native(void* key)
+{
+    MonoString* result = NULL;
+    if (key) kv_with_string((const KvKey*)key, [&](const std::string& str) { result = mono_string_new(mono_domain_get(), str.c_str()); });
+    return result;
+}
+
+static void kv_set_double_native(void* key, double value)
+{
+    if (key) kv_set_real((const KvKey*)key, value);
+}
+
+static void kv_set_long_native(void* key, int64 value)
+{
+    if (key) kv_set_int64((const KvKey*)key, value);
+}
+
+static void kv_set_string_native(void* key, MonoString* value)
+{
+    if (!key) return;
+    if (!value)
+    {
+        kv_write((const KvKey*)key, KV_NONE, 0);
+        return;
+    }
+    char* str = mono_string_to_utf8(value);
+    kv_set_string((const KvKey*)key, str);
+    mono_free(str);
+}
+
+static void kv_remove_native(void* key)
+{
+    if (key) kv_write((const KvKey*)key, KV_NONE, 0);
+}
+
+void kv_init()
+{
+    mono_add_internal_call("GMSL.KeyValue::KeyNative", (const void*)kv_key_native);
+    mono_add_internal_call("GMSL.KeyValue::TryGetDoubleNative", (const void*)kv_try_get_double_native);
+    mono_add_internal_call("GMSL.KeyValue::TryGetLongNative", (const void*)kv_try_get_long_native);
+    mono_add_internal_call("GMSL.KeyValue::GetStringNative", (const void*)kv_get_string_native);
+    mono_add_internal_call("GMSL.KeyValue::SetDoubleNative", (const void*)kv_set_double_native);
+    mono_add_internal_call("GMSL.KeyValue::SetLongNative", (const void*)kv_set_long_native);
+    mono_add_internal_call("GMSL.KeyValue::SetStringNative", (const void*)kv_set_string_native);
+    mono_add_internal_call("GMSL.KeyValue::RemoveNative", (const void*)kv_remove_native);
+}
+
+// GML side, keys can be passed as a string or as the id returned by interop_kv_key
+
+static const KvKey* kv_key_arg(RValue* arg, int index)
+{
+    if ((arg[index].kind & MASK_KIND_RVALUE) == VALUE_STRING) return kv_intern(arg[index].GetString());
+
+    int64 id = YYGetInt64(arg, index);
+    if (id < 0 || id >= (int64)kvKeyCount.load(std::memory_order_acquire))
+    {
+        LOG_ERROR("key-value store has no key with id " << id);
+        return NULL;
+    }
+    return kvKeyIds[id].load(std::memory_order_acquire);
+}
+
+// interop_kv_key(name), returns the key's id or -1 when the store is out of keys
+YYEXPORT void interop_kv_key(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    const KvKey* key = kv_intern(YYGetString(arg, 0));
+    Result.kind = VALUE_REAL;
+    Result.val = key ? key->id : -1;
+}
+
+YYEXPORT void interop_kv_set(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    Result.kind = VALUE_REAL;
+    Result.val = 0;
+
+    const KvKey* key = kv_key_arg(arg, 0);
+    if (!key) return;
+
+    switch (arg[1].kind & MASK_KIND_RVALUE)
+    {
+        case VALUE_STRING:
+            kv_set_string(key, arg[1].GetString());
+            break;
+
+        case VALUE_INT64:
+        case VALUE_INT32:
+            kv_set_int64(key, YYGetInt64(arg, 1));
+            break;
+
+        case VALUE_UNDEFINED:
+            kv_write(key, KV_NONE, 0);
+            break;
+
+        default:
+            kv_set_real(key, YYGetReal(arg, 1));
+            break;
+    }
+    Result.val = 1;
+}
+
+// interop_kv_get(key, [default])
+YYEXPORT void interop_kv_get(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    const KvKey* key = kv_key_arg(arg, 0);
+    KvValue value;
+    if (key && kv_read(kv_find(key), value))
+    {
+        switch (value.kind)
+        {
+            case KV_REAL:
+                Result.kind = VALUE_REAL;
+                Result.val = kv_real(value);
+                return;
+
+            case KV_INT64:
+                Result.kind = VALUE_INT64;
+                Result.v64 = (int64)value.bits;
+                return;
+
+            default:
+                if (kv_with_string(key, [&](const std::string& str) { YYCreateString(&Result, str.c_str()); })) return;
+                break;
+        }
+    }
+
+    if (argc > 1)
+    {
+        COPY_RValue(&Result, &arg[1]);
+    }
+    else
+    {
+        Result.kind = VALUE_UNDEFINED;
+        Result.v64 = 0;
+    }
+}
+
+YYEXPORT void interop_kv_exists(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    const KvKey* key = kv_key_arg(arg, 0);
+    KvValue value;
+    Result.kind = VALUE_REAL;
+    Result.val = key && kv_read(kv_find(key), value);
+}
+
+YYEXPORT void interop_kv_remove(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    const KvKey* key = kv_key_arg(arg, 0);
+    if (key) kv_write(key, KV_NONE, 0);
+    Result.kind = VALUE_REAL;
+    Result.val = key != NULL;
+}
@@ -0,0 +1,166 @@
+#include "interop.h"
+#include <mono/metadata/assembly.h>
+#include <mono/metadata/loader.h>
+#include <cctype>
+#include <cstring>
+#include <vector>
+
+// cache.interop is written by the patcher next to cache.win, see InteropManifest.cs for the layout. Every
+// [GmlInterop] method is bound once here by metadata token, and the generated GML scripts pick their binding
+// with interop_set_id(id) instead of passing dll / namespace / class / method names on every call.
+
+#define MANIFEST_MAGIC 0x4d494d47 // "GMIM"
+#define MANIFEST_VERSION 1
+
+enum ManifestSignature : uint8_t
+{
+    MANIFEST_BOXED = 0,
+    MANIFEST_BLITTABLE = 1
+};
+
+#pragma pack(push, 1)
+struct ManifestHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t assemblyCount;
+    uint32_t entryCount;
+};
+
+struct ManifestEntry
+{
+    uint16_t assembly;
+    uint8_t signature;
+    uint8_t argc;
+    uint32_t token;
+};
+#pragma pack(pop)
+
+static std::vector<InteropBinding> manifestBindings;
+
+static bool manifest_guid_equals(const char* a, const char* b, size_t length)
+{
+    if (!a || std::strlen(a) != length) return false;
+    for (size_t i = 0; i < length; i++)
+    {
+        if (std::tolower((unsigned char)a[i]) != std::tolower((unsigned char)b[i])) return false;
+    }
+    return true;
+}
+
+void manifest_load(const std::filesystem::path& path)
+{
+    manifestBindings.clear();
+
+    FileMapping map;
+    if (!file_map(path, map))
+    {
+        file_unmap(map);
+        LOG_INFO("No interop manifest at " << path.string() << ", interop scripts fall back to binding by name");
+        return;
+    }
+
+    const uint8_t* cursor = map.data;
+    const uint8_t* end = map.data + map.size;
+    ManifestHeader header;
+    if (map.size < sizeof(header))
+    {
+        LOG_ERROR("interop manifest " << path.string() << " is truncated");
+        file_unmap(map);
+        return;
+    }
+    std::memcpy(&header, cursor, sizeof(header));
+    cursor += sizeof(header);
+    if (header.magic != MANIFEST_MAGIC || header.version != MANIFEST_VERSION)
+    {
+        LOG_ERROR("interop manifest " << path.string() << " has an unknown format, rebuild cache.win");
+        file_unmap(map);
+        return;
+    }
+
+    // an assembly whose module version id changed since patching doesn't match its tokens anymore, its
+    // entries are left unbound
+    std::vector<MonoImage*> images(header.assemblyCount, NULL);
+    bool truncated = false;
+    for (uint32_t i = 0; i < header.assemblyCount; i++)
+    {
+        uint16_t nameLength, guidLength;
+        if (end - cursor < 2)
+        {
+            truncated = true;
+            break;
+        }
+        std::memcpy(&nameLength, cursor, 2);
+        cursor += 2;
+        if (end - cursor < nameLength + 2)
+        {
+            truncated = true;
+            break;
+        }
+        std::string name((const char*)cursor, nameLength);
+        cursor += nameLength;
+        std::memcpy(&guidLength, cursor, 2);
+        cursor += 2;
+        if (end - cursor < guidLength)
+        {
+            truncated = true;
+            break;
+        }
+        const char* guid = (const char*)cursor;
+        cursor += guidLength;
+
+        auto mod = mods.find(name);
+        if (mod == mods.end())
+        {
+            LOG_WARN("interop manifest references " << name << " which isn't loaded");
+            continue;
+        }
+        if (!manifest_guid_equals(mono_image_get_guid(mod->second), guid, guidLength))
+        {
+            LOG_WARN(name << " changed since cache.win was built, its interop scripts fall back to binding by name");
+            continue;
+        }
+        images[i] = mod->second;
+    }
+
+    // entries follow the assembly table, after a cut short table the cursor is somewhere in the middle of a record
+    if (truncated || (size_t)(end - cursor) < (size_t)header.entryCount * sizeof(ManifestEntry))
+    {
+        LOG_ERROR("interop manifest " << path.string() << " is truncated, interop scripts fall back to binding by name");
+        file_unmap(map);
+        return;
+    }
+
+    manifestBindings.resize(header.entryCount, InteropBinding());
+    uint32_t bound = 0;
+    for (uint32_t id = 0; id < header.entryCount; id++, cursor += sizeof(ManifestEntry))
+    {
+        ManifestEntry entry;
+        std::memcpy(&entry, cursor, sizeof(entry));
+        if (entry.assembly >= header.assemblyCount || !images[entry.assembly]) continue;
+
+        InteropBinding& binding = manifestBindings[id];
+        binding.method = mono_get_method(images[entry.assembly], entry.token, NULL);
+        if (!binding.method)
+        {
+            LOG_ERROR("interop manifest entry " << id << " has no method for token " << entry.token);
+            continue;
+        }
+        binding.name = mono_method_get_name(binding.method);
+        binding.fast = entry.signature == MANIFEST_BLITTABLE && fastcall_bind(binding.fastCall, binding.method);
+        bound++;
+    }
+
+    file_unmap(map);
+    LOG_INFO("Bound " << bound << " of " << header.entryCount << " interop methods from " << path.string());
+}
+
+// interop_set_id(id), id is the entry index in cache.interop
+// returns 0 when the entry didn't bind, the generated script then calls interop_set_function with the names
+YYEXPORT void interop_set_id(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    uint32_t id = (uint32_t)YYGetInt32(arg, 0);
+    currentBinding = id < manifestBindings.size() ? &manifestBindings[id] : NULL;
+    Result.kind = VALUE_REAL;
+    Result.val = currentBinding != NULL && currentBinding->method != NULL;
+}
@@ -0,0 +1,57 @@
+#include "interop.h"
+
+#ifdef OS_Windows
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// read only file mappings, shared by the interop manifest and the mod asset packs
+
+bool file_map(const std::filesystem::path& path, FileMapping& map)
+{
+#ifdef OS_Windows
+    map.file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (map.file == INVALID_HANDLE_VALUE)
+    {
+        map.file = NULL;
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(map.file, &size) || size.QuadPart == 0) return false;
+    map.size = (size_t)size.QuadPart;
+    map.mapping = CreateFileMappingW(map.file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!map.mapping) return false;
+    map.data = (const uint8_t*)MapViewOfFile(map.mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+    map.size = (size_t)st.st_size;
+    void* data = mmap(NULL, map.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    map.data = data == MAP_FAILED ? NULL : (const uint8_t*)data;
+#endif
+    return map.data != NULL;
+}
+
+void file_unmap(FileMapping& map)
+{
+#ifdef OS_Windows
+    if (map.data) UnmapViewOfFile(map.data);
+    if (map.mapping) CloseHandle(map.mapping);
+    if (map.file) CloseHandle(map.file);
+#else
+    if (map.data) munmap((void*)map.data, map.size);
+#endif
+    map = FileMapping();
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "extensions/Extension_Interface.h"
+#include "extensions/YYRValue.h"
+#include <cstdint>
+
+// Native mod plugins. A mod can ship gmsl/mods/<mod>/<mod>.native.dll (.so off windows) next to its C# assembly;
+// gmsl-interop loads it at startup and calls its gmsl_plugin_init export with the runner interface, which stays
+// valid for the lifetime of the game. The plugin returns its function table, and GML calls those functions with
+//   var id = interop_native_id("<mod>", "<function>");   // once
+//   interop_native_call(id, args...);                    // the function gets args... as arg / argc
+// which is a single indirect call, nothing goes through mono.
+//
+//   static const GmslPluginFunction functions[] = { { "add", plugin_add } };
+//   static const GmslPlugin plugin = { GMSL_PLUGIN_VERSION, 1, functions };
+//
+//   extern "C" YYEXPORT const GmslPlugin* gmsl_plugin_init(const YYRunnerInterface* functions, size_t size)
+//   {
+//       g_pYYRunnerInterface = (YYRunnerInterface*)functions;
+//       return &plugin;
+//   }
+//
+// Returning NULL skips the plugin. The table and names have to outlive the call, plugins are never unloaded.
+
+#define GMSL_PLUGIN_VERSION 1
+#define GMSL_PLUGIN_INIT "gmsl_plugin_init"
+
+struct GmslPluginFunction
+{
+    const char* name;
+    TYYBuiltin function;
+};
+
+struct GmslPlugin
+{
+    uint32_t version;
+    uint32_t functionCount;
+    const GmslPluginFunction* functions;
+};
+
+typedef const GmslPlugin* (*GmslPluginInit)(const YYRunnerInterface* functions, size_t size);
@@ -0,0 +1,109 @@
+#include "interop.h"
+#include "plugin.h"
+#include <unordered_map>
+#include <vector>
+
+#ifdef OS_Windows
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#define PLUGIN_EXTENSION ".native.dll"
+#else
+#include <dlfcn.h>
+#define PLUGIN_EXTENSION ".native.so"
+#endif
+
+// Native mod plugins, see plugin.h for what a plugin exports. Ids index nativeFunctions, which only holds the
+// function pointers so interop_native_call is a bounds check and an indirect call.
+
+static std::vector<TYYBuiltin> nativeFunctions;
+static std::unordered_map<std::string, uint32_t> nativeIds;
+
+void plugins_load(const std::string& mod, const std::filesystem::path& directory)
+{
+    std::filesystem::path path = directory / (mod + PLUGIN_EXTENSION);
+    if (!std::filesystem::exists(path)) return;
+
+#ifdef OS_Windows
+    // the altered search path lets a plugin's own dependencies sit next to it
+    HMODULE module = LoadLibraryExW(path.wstring().c_str(), NULL, LOAD_WITH_ALTERED_SEARCH_PATH);
+    if (!module)
+    {
+        LOG_ERROR("Couldn't load native plugin " << path.string() << ", error " << GetLastError());
+        return;
+    }
+    GmslPluginInit init = (GmslPluginInit)GetProcAddress(module, GMSL_PLUGIN_INIT);
+#else
+    void* module = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!module)
+    {
+        LOG_ERROR("Couldn't load native plugin " << path.string() << ": " << dlerror());
+        return;
+    }
+    GmslPluginInit init = (GmslPluginInit)dlsym(module, GMSL_PLUGIN_INIT);
+#endif
+    if (!init)
+    {
+        LOG_ERROR("Native plugin " << path.string() << " doesn't export " << GMSL_PLUGIN_INIT);
+        return;
+    }
+
+    const GmslPlugin* plugin = init(&gs_runnerInterface, sizeof(YYRunnerInterface));
+    if (!plugin)
+    {
+        LOG_WARN("Native plugin for " << mod << " didn't initialise");
+        return;
+    }
+    if (plugin->version != GMSL_PLUGIN_VERSION)
+    {
+        LOG_ERROR("Native plugin for " << mod << " is version " << plugin->version << ", expected " << GMSL_PLUGIN_VERSION);
+        return;
+    }
+
+    uint32_t registered = 0;
+    for (uint32_t i = 0; i < plugin->functionCount; i++)
+    {
+        const GmslPluginFunction& function = plugin->functions[i];
+        if (!function.name || !function.function) continue;
+
+        std::string key = mod + '/' + function.name;
+        if (nativeIds.count(key))
+        {
+            LOG_WARN("Native plugin for " << mod << " registers " << function.name << " twice");
+            continue;
+        }
+        nativeIds[key] = (uint32_t)nativeFunctions.size();
+        nativeFunctions.push_back(function.function);
+        registered++;
+    }
+
+    LOG_INFO("Loaded native plugin for " << mod << " with " << registered << " functions");
+}
+
+// interop_native_id(mod, function), -1 when the mod has no such native function
+YYEXPORT void interop_native_id(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    auto found = nativeIds.find(std::string(YYGetString(arg, 0)) + '/' + YYGetString(arg, 1));
+    Result.kind = VALUE_REAL;
+    Result.val = found != nativeIds.end() ? (double)found->second : -1;
+}
+
+// interop_native_call(id, args...), the native function writes Result itself
+YYEXPORT void interop_native_call(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    if (argc < 1)
+    {
+        LOG_ERROR("interop_native_call needs an id");
+        Result.kind = VALUE_UNDEFINED;
+        return;
+    }
+
+    // ids are reals from interop_native_id, skip the runner's conversion for them
+    int64_t id = (arg[0].kind & MASK_KIND_RVALUE) == VALUE_REAL ? (int64_t)arg[0].val : YYGetInt64(arg, 0);
+    if (id < 0 || (uint64_t)id >= nativeFunctions.size())
+    {
+        LOG_ERROR("interop_native_call with unknown id " << id);
+        Result.kind = VALUE_UNDEFINED;
+        return;
+    }
+    nativeFunctions[id](Result, selfinst, otherinst, argc - 1, arg + 1);
+}
@@ -0,0 +1,255 @@
+#include "interop.h"
+#include <algorithm>
+#include <vector>
+
+// Cooperative scheduler for C# jobs that have to stay on the game thread but don't fit in one frame. A job is an
+// IEnumerator, every MoveNext is one slice of work, and interop_tick resumes jobs until the frame budget runs out.
+// Yielding a number reports progress (0 to 1) that GML can read back with interop_job_progress.
+
+enum JobStatus
+{
+    JOB_RUNNING = 0,
+    JOB_DONE = 1,
+    JOB_FAILED = 2,
+    JOB_CANCELLED = 3
+};
+
+struct Job
+{
+    std::string name;
+    uint32_t handle;
+    int priority;
+    JobStatus status;
+    double progress;
+    int64 time;
+    uint64 resumes;
+    MonoMethod* moveNext;
+    MonoMethod* current;
+};
+
+static std::map<int, Job> jobs;
+static int nextJobId = 1;
+static int64 schedulerBudget = 2000;
+
+static MonoMethod* enumeratorMoveNext;
+static MonoMethod* enumeratorCurrent;
+
+static int scheduler_start(MonoObject* enumerator, int priority, const std::string& name)
+{
+    if (!enumerator) return -1;
+
+    Job job = Job();
+    job.name = name;
+    job.handle = mono_gchandle_new(enumerator, false);
+    job.priority = std::max(priority, 1);
+    job.status = JOB_RUNNING;
+    job.moveNext = mono_object_get_virtual_method(enumerator, enumeratorMoveNext);
+    job.current = mono_object_get_virtual_method(enumerator, enumeratorCurrent);
+
+    int id = nextJobId++;
+    jobs[id] = job;
+    return id;
+}
+
+static int32_t scheduler_start_native(MonoObject* enumerator, int32_t priority, MonoString* name)
+{
+    char* str = name ? mono_string_to_utf8(name) : NULL;
+    int id = scheduler_start(enumerator, priority, str ? str : "job");
+    mono_free(str);
+    return id;
+}
+
+void scheduler_init()
+{
+    MonoClass* enumerator = mono_class_from_name(mono_get_corlib(), "System.Collections", "IEnumerator");
+    enumeratorMoveNext = mono_class_get_method_from_name(enumerator, "MoveNext", 0);
+    enumeratorCurrent = mono_class_get_method_from_name(enumerator, "get_Current", 0);
+    mono_add_internal_call("GMSL.Scheduler::StartNative", (const void*)scheduler_start_native);
+}
+
+static void scheduler_finish(Job& job, JobStatus status)
+{
+    job.status = status;
+    if (status == JOB_DONE) job.progress = 1;
+    mono_gchandle_free(job.handle);
+    job.handle = 0;
+}
+
+// one MoveNext, returns false once the job stopped running
+static bool scheduler_resume(Job& job)
+{
+    MonoObject* enumerator = mono_gchandle_get_target(job.handle);
+    MonoObject* exception = NULL;
+
+    int64 start = Timing_Time();
+    MonoObject* more = mono_runtime_invoke(job.moveNext, enumerator, NULL, &exception);
+    job.time += Timing_Time() - start;
+    job.resumes++;
+
+    if (exception)
+    {
+        interop_print_exception(exception, job.name);
+        scheduler_finish(job, JOB_FAILED);
+        return false;
+    }
+    if (!*(bool*)mono_object_unbox(more))
+    {
+        scheduler_finish(job, JOB_DONE);
+        return false;
+    }
+
+    MonoObject* current = mono_runtime_invoke(job.current, enumerator, NULL, &exception);
+    if (exception)
+    {
+        interop_print_exception(exception, job.name);
+        scheduler_finish(job, JOB_FAILED);
+        return false;
+    }
+    if (current)
+    {
+        MonoClass* klass = mono_object_get_class(current);
+        if (klass == mono_get_double_class()) job.progress = *(double*)mono_object_unbox(current);
+        else if (klass == mono_get_single_class()) job.progress = *(float*)mono_object_unbox(current);
+    }
+    return true;
+}
+
+// every pass gives each job a turn in priority order (ties by start order), a higher priority gets more resumes per
+// turn, and passes repeat until the budget is used up. When the budget runs out mid-pass the next frame finishes that
+// pass from where it stopped, then starts new passes from the top. Every frame resumes at least one job, so a tight
+// budget still gets round to the low priority ones
+struct SchedulerPosition
+{
+    int priority;
+    int id;
+};
+
+static bool schedulerMidPass = false;
+static SchedulerPosition schedulerNext;
+
+void scheduler_run()
+{
+    std::vector<std::pair<int, Job*>> running;
+    for (auto& entry : jobs)
+    {
+        if (entry.second.status == JOB_RUNNING) running.push_back({ entry.first, &entry.second });
+    }
+    if (running.empty()) return;
+
+    std::stable_sort(running.begin(), running.end(), [](const auto& a, const auto& b) { return a.second->priority > b.second->priority; });
+
+    // the job that was next may have finished since, so the pass picks up at the first one that sorts at or after it
+    auto it = running.begin();
+    if (schedulerMidPass)
+    {
+        it = std::lower_bound(running.begin(), running.end(), schedulerNext, [](const auto& job, const SchedulerPosition& next)
+        {
+            return job.second->priority > next.priority || (job.second->priority == next.priority && job.first < next.id);
+        });
+        schedulerMidPass = false;
+    }
+
+    int64 deadline = Timing_Time() + schedulerBudget;
+    uint64 resumed = 0;
+    while (!running.empty())
+    {
+        if (it == running.end()) it = running.begin();
+        while (it != running.end())
+        {
+            if (resumed && Timing_Time() >= deadline)
+            {
+                schedulerMidPass = it != running.begin();
+                schedulerNext = { it->second->priority, it->first };
+                return;
+            }
+
+            bool alive = true;
+            for (int i = 0; i < it->second->priority && alive && (!resumed || Timing_Time() < deadline); i++)
+            {
+                alive = scheduler_resume(*it->second);
+                resumed++;
+            }
+            it = alive ? it + 1 : running.erase(it);
+        }
+    }
+}
+
+// interop_job_start(dll, namespace, class, method, priority) calls a static method returning IEnumerator and schedules it
+YYEXPORT void interop_job_start(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    Result.kind = VALUE_REAL;
+    Result.val = -1;
+
+    auto image = mods.find(arg[0].GetString());
+    if (image == mods.end()) return;
+    MonoClass* klass = mono_class_from_name(image->second, arg[1].GetString(), arg[2].GetString());
+    MonoMethod* method = klass ? mono_class_get_method_from_name(klass, arg[3].GetString(), 0) : NULL;
+    if (!method)
+    {
+        LOG_ERROR("can't find job method " << arg[1].GetString() << "." << arg[2].GetString() << "." << arg[3].GetString());
+        return;
+    }
+
+    MonoObject* exception = NULL;
+    MonoObject* enumerator = mono_runtime_invoke(method, NULL, NULL, &exception);
+    if (exception)
+    {
+        interop_print_exception(exception, arg[3].GetString());
+        return;
+    }
+
+    Result.val = scheduler_start(enumerator, argc > 4 ? YYGetInt32(arg, 4) : 1, arg[3].GetString());
+}
+
+YYEXPORT void interop_job_status(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    auto job = jobs.find(YYGetInt32(arg, 0));
+    Result.kind = VALUE_REAL;
+    Result.val = job == jobs.end() ? -1 : job->second.status;
+}
+
+YYEXPORT void interop_job_progress(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    auto job = jobs.find(YYGetInt32(arg, 0));
+    Result.kind = VALUE_REAL;
+    Result.val = job == jobs.end() ? 0 : job->second.progress;
+}
+
+// total time the job has spent running, in microseconds
+YYEXPORT void interop_job_time(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    auto job = jobs.find(YYGetInt32(arg, 0));
+    Result.kind = VALUE_REAL;
+    Result.val = job == jobs.end() ? 0 : (double)job->second.time;
+}
+
+YYEXPORT void interop_job_cancel(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    auto job = jobs.find(YYGetInt32(arg, 0));
+    Result.kind = VALUE_REAL;
+    Result.val = 0;
+    if (job == jobs.end() || job->second.status != JOB_RUNNING) return;
+
+    scheduler_finish(job->second, JOB_CANCELLED);
+    Result.val = 1;
+}
+
+// forgets a finished job so its status can't be queried anymore
+YYEXPORT void interop_job_free(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    auto job = jobs.find(YYGetInt32(arg, 0));
+    Result.kind = VALUE_REAL;
+    Result.val = 0;
+    if (job == jobs.end() || job->second.status == JOB_RUNNING) return;
+
+    jobs.erase(job);
+    Result.val = 1;
+}
+
+// per frame time budget for all jobs together, in microseconds
+YYEXPORT void interop_scheduler_budget(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    if (argc > 0) schedulerBudget = YYGetInt64(arg, 0);
+    Result.kind = VALUE_REAL;
+    Result.val = (double)schedulerBudget;
+}
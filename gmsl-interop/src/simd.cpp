@@ -0,0 +1,419 @@
+// no mono in here, so gmsl-simd-test can build this file against a stand-in runner
+#include "extensions/Extension_Interface.h"
+#include "extensions/YYRValue.h"
+#include "gmsl-log.h"
+#include "simd_kernels.h"
+#include <cstring>
+
+#if SIMD_X86
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+const SimdKernels simdScalar = simd_kernels<ScalarLanes<float>, ScalarLanes<double>, ScalarLanes<int32_t>>();
+
+#if SIMD_X86
+
+// sse2 is the x64 baseline, so it's always there as the fallback below avx2
+
+template <typename T, typename R>
+static T* sse2_compress(T* out, R x, unsigned mask, unsigned full)
+{
+    constexpr size_t N = sizeof(R) / sizeof(T);
+    if (mask == full)
+    {
+        std::memcpy(out, &x, sizeof(R));
+        return out + N;
+    }
+
+    // no variable shuffle before ssse3, store every lane and only advance past the selected ones (no branches to
+    // mispredict on mixed masks)
+    T lanes[N];
+    std::memcpy(lanes, &x, sizeof(R));
+    for (size_t i = 0; i < N; i++)
+    {
+        *out = lanes[i];
+        out += (mask >> i) & 1;
+    }
+    return out;
+}
+
+struct Sse2F32
+{
+    using Type = float;
+    using Reg = __m128;
+    static constexpr size_t N = 4;
+
+    static Reg load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, Reg x) { _mm_storeu_ps(p, x); }
+    static Reg set1(float x) { return _mm_set1_ps(x); }
+    static Reg add(Reg a, Reg b) { return _mm_add_ps(a, b); }
+    static Reg mul(Reg a, Reg b) { return _mm_mul_ps(a, b); }
+    static Reg min(Reg a, Reg b) { return _mm_min_ps(a, b); }
+    static Reg max(Reg a, Reg b) { return _mm_max_ps(a, b); }
+    static Reg abs(Reg a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+
+    static Reg scan(Reg x)
+    {
+        x = _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 4)));
+        return _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 8)));
+    }
+
+    static Reg last(Reg x) { return _mm_shuffle_ps(x, x, _MM_SHUFFLE(3, 3, 3, 3)); }
+
+    static double sum(const float* p, size_t n)
+    {
+        __m128d low = _mm_setzero_pd(), high = _mm_setzero_pd();
+        for (size_t i = 0; i < n; i += N)
+        {
+            Reg x = _mm_loadu_ps(p + i);
+            low = _mm_add_pd(low, _mm_cvtps_pd(x));
+            high = _mm_add_pd(high, _mm_cvtps_pd(_mm_movehl_ps(x, x)));
+        }
+        double lanes[2];
+        _mm_storeu_pd(lanes, _mm_add_pd(low, high));
+        return lanes[0] + lanes[1];
+    }
+
+    template <SimdCmp C>
+    static unsigned mask(Reg x, Reg v)
+    {
+        if constexpr (C == SimdCmp::Lt) return _mm_movemask_ps(_mm_cmplt_ps(x, v));
+        else if constexpr (C == SimdCmp::Le) return _mm_movemask_ps(_mm_cmple_ps(x, v));
+        else if constexpr (C == SimdCmp::Gt) return _mm_movemask_ps(_mm_cmpgt_ps(x, v));
+        else if constexpr (C == SimdCmp::Ge) return _mm_movemask_ps(_mm_cmpge_ps(x, v));
+        else if constexpr (C == SimdCmp::Eq) return _mm_movemask_ps(_mm_cmpeq_ps(x, v));
+        else return _mm_movemask_ps(_mm_cmpneq_ps(x, v));
+    }
+
+    static float* compress(float* out, Reg x, unsigned mask) { return sse2_compress<float>(out, x, mask, 0xF); }
+};
+
+struct Sse2F64
+{
+    using Type = double;
+    using Reg = __m128d;
+    static constexpr size_t N = 2;
+
+    static Reg load(const double* p) { return _mm_loadu_pd(p); }
+    static void store(double* p, Reg x) { _mm_storeu_pd(p, x); }
+    static Reg set1(double x) { return _mm_set1_pd(x); }
+    static Reg add(Reg a, Reg b) { return _mm_add_pd(a, b); }
+    static Reg mul(Reg a, Reg b) { return _mm_mul_pd(a, b); }
+    static Reg min(Reg a, Reg b) { return _mm_min_pd(a, b); }
+    static Reg max(Reg a, Reg b) { return _mm_max_pd(a, b); }
+    static Reg abs(Reg a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+    static Reg scan(Reg x) { return _mm_add_pd(x, _mm_castsi128_pd(_mm_slli_si128(_mm_castpd_si128(x), 8))); }
+    static Reg last(Reg x) { return _mm_unpackhi_pd(x, x); }
+
+    static double sum(const double* p, size_t n)
+    {
+        __m128d acc = _mm_setzero_pd();
+        for (size_t i = 0; i < n; i += N) acc = _mm_add_pd(acc, _mm_loadu_pd(p + i));
+        double lanes[2];
+        _mm_storeu_pd(lanes, acc);
+        return lanes[0] + lanes[1];
+    }
+
+    template <SimdCmp C>
+    static unsigned mask(Reg x, Reg v)
+    {
+        if constexpr (C == SimdCmp::Lt) return _mm_movemask_pd(_mm_cmplt_pd(x, v));
+        else if constexpr (C == SimdCmp::Le) return _mm_movemask_pd(_mm_cmple_pd(x, v));
+        else if constexpr (C == SimdCmp::Gt) return _mm_movemask_pd(_mm_cmpgt_pd(x, v));
+        else if constexpr (C == SimdCmp::Ge) return _mm_movemask_pd(_mm_cmpge_pd(x, v));
+        else if constexpr (C == SimdCmp::Eq) return _mm_movemask_pd(_mm_cmpeq_pd(x, v));
+        else return _mm_movemask_pd(_mm_cmpneq_pd(x, v));
+    }
+
+    static double* compress(double* out, Reg x, unsigned mask) { return sse2_compress<double>(out, x, mask, 0x3); }
+};
+
+struct Sse2I32
+{
+    using Type = int32_t;
+    using Reg = __m128i;
+    static constexpr size_t N = 4;
+
+    static Reg load(const int32_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+    static void store(int32_t* p, Reg x) { _mm_storeu_si128((__m128i*)p, x); }
+    static Reg set1(int32_t x) { return _mm_set1_epi32(x); }
+    static Reg add(Reg a, Reg b) { return _mm_add_epi32(a, b); }
+
+    // no pmulld before sse4.1, multiply the even and odd lanes separately and put the low halves back together
+    static Reg mul(Reg a, Reg b)
+    {
+        __m128i even = _mm_mul_epu32(a, b);
+        __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+        return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    }
+
+    static Reg select(Reg mask, Reg a, Reg b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+    static Reg min(Reg a, Reg b) { return select(_mm_cmplt_epi32(a, b), a, b); }
+    static Reg max(Reg a, Reg b) { return select(_mm_cmpgt_epi32(a, b), a, b); }
+
+    static Reg abs(Reg a)
+    {
+        __m128i sign = _mm_srai_epi32(a, 31);
+        return _mm_sub_epi32(_mm_xor_si128(a, sign), sign);
+    }
+
+    static Reg scan(Reg x)
+    {
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+        return _mm_add_epi32(x, _mm_slli_si128(x, 8));
+    }
+
+    static Reg last(Reg x) { return _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3)); }
+
+    static double sum(const int32_t* p, size_t n)
+    {
+        __m128i acc = _mm_setzero_si128();
+        for (size_t i = 0; i < n; i += N)
+        {
+            __m128i x = load(p + i);
+            __m128i sign = _mm_srai_epi32(x, 31);
+            acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(x, sign));
+            acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(x, sign));
+        }
+        int64_t lanes[2];
+        _mm_storeu_si128((__m128i*)lanes, acc);
+        return (double)(lanes[0] + lanes[1]);
+    }
+
+    template <SimdCmp C>
+    static unsigned mask(Reg x, Reg v)
+    {
+        if constexpr (C == SimdCmp::Lt) return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(x, v)));
+        else if constexpr (C == SimdCmp::Le) return ~_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(x, v))) & 0xF;
+        else if constexpr (C == SimdCmp::Gt) return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(x, v)));
+        else if constexpr (C == SimdCmp::Ge) return ~_mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(x, v))) & 0xF;
+        else if constexpr (C == SimdCmp::Eq) return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(x, v)));
+        else return ~_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(x, v))) & 0xF;
+    }
+
+    static int32_t* compress(int32_t* out, Reg x, unsigned mask) { return sse2_compress<int32_t>(out, x, mask, 0xF); }
+};
+
+const SimdKernels simdSse2 = simd_kernels<Sse2F32, Sse2F64, Sse2I32>();
+
+static int simd_detect()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return SIMD_SSE2;
+
+    // avx2 needs the os to save the ymm registers too
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) return SIMD_SSE2;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) ? SIMD_AVX2 : SIMD_SSE2;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? SIMD_AVX2 : SIMD_SSE2;
+#endif
+}
+
+#else
+
+static int simd_detect()
+{
+    return SIMD_SCALAR;
+}
+
+#endif
+
+static const int simdSupported = simd_detect();
+static int simdLevel = simdSupported;
+
+static const SimdKernels& simd()
+{
+#if SIMD_X86
+    if (simdLevel >= SIMD_AVX2) return simdAvx2;
+    if (simdLevel >= SIMD_SSE2) return simdSse2;
+#endif
+    return simdScalar;
+}
+
+// GML buffer_* type constants
+#define GML_BUFFER_S32 6
+#define GML_BUFFER_F32 8
+#define GML_BUFFER_F64 9
+
+// every kernel takes (buffer, size, type, ..., [offset], [count]) with size and offset in bytes, count defaults to every
+// element between offset and the buffer's current tell. IBuffer is opaque to extensions and the runner's only size
+// query (BufferGetContent) copies the whole buffer, so the caller passes buffer_get_size(buffer) and the range is
+// clamped to that. The kernels write in place.
+static bool simd_range(int argc, RValue* arg, int offsetArg, SimdLane& lane, uint8_t*& data, size_t& count)
+{
+    IBuffer* buffer = BufferGetFromGML(YYGetInt32(arg, 0));
+    if (!buffer) return false;
+
+    int size = YYGetInt32(arg, 1);
+    if (size < 0)
+    {
+        LOG_ERROR("buffer kernel size " << size << " is negative");
+        return false;
+    }
+
+    size_t laneSize;
+    switch (YYGetInt32(arg, 2))
+    {
+        case GML_BUFFER_F32: lane = SimdLane::F32; laneSize = 4; break;
+        case GML_BUFFER_F64: lane = SimdLane::F64; laneSize = 8; break;
+        case GML_BUFFER_S32: lane = SimdLane::I32; laneSize = 4; break;
+        default:
+            LOG_ERROR("buffer kernels only work on buffer_f32, buffer_f64 and buffer_s32");
+            return false;
+    }
+
+    int offset = argc > offsetArg ? YYGetInt32(arg, offsetArg) : 0;
+    if (offset < 0 || offset > size)
+    {
+        LOG_ERROR("buffer kernel offset " << offset << " is outside the buffer (" << size << " bytes)");
+        return false;
+    }
+
+    size_t available = (size_t)(size - offset) / laneSize;
+    if (argc > offsetArg + 1 && YYGetInt32(arg, offsetArg + 1) >= 0)
+    {
+        count = (size_t)YYGetInt32(arg, offsetArg + 1);
+        if (count > available) count = available;
+    }
+    else
+    {
+        int tell = BufferTELL(buffer);
+        if (tell > size) tell = size;
+        count = tell > offset ? (size_t)(tell - offset) / laneSize : 0;
+    }
+
+    data = BufferGet(buffer) + offset;
+    return true;
+}
+
+static bool simd_map_op(const char* name, SimdMapOp& op)
+{
+    if (std::strcmp(name, "add") == 0) op = SimdMapOp::Add;
+    else if (std::strcmp(name, "mul") == 0) op = SimdMapOp::Mul;
+    else if (std::strcmp(name, "fma") == 0) op = SimdMapOp::Fma;
+    else if (std::strcmp(name, "min") == 0) op = SimdMapOp::Min;
+    else if (std::strcmp(name, "max") == 0) op = SimdMapOp::Max;
+    else if (std::strcmp(name, "clamp") == 0) op = SimdMapOp::Clamp;
+    else if (std::strcmp(name, "abs") == 0) op = SimdMapOp::Abs;
+    else return false;
+    return true;
+}
+
+static bool simd_cmp(const char* name, SimdCmp& cmp)
+{
+    if (std::strcmp(name, "<") == 0) cmp = SimdCmp::Lt;
+    else if (std::strcmp(name, "<=") == 0) cmp = SimdCmp::Le;
+    else if (std::strcmp(name, ">") == 0) cmp = SimdCmp::Gt;
+    else if (std::strcmp(name, ">=") == 0) cmp = SimdCmp::Ge;
+    else if (std::strcmp(name, "==") == 0) cmp = SimdCmp::Eq;
+    else if (std::strcmp(name, "!=") == 0) cmp = SimdCmp::Ne;
+    else return false;
+    return true;
+}
+
+// interop_buffer_map(buffer, size, type, op, a, b, [offset], [count]), op is add, mul, fma, min, max, clamp or abs
+YYEXPORT void interop_buffer_map(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    Result.kind = VALUE_REAL;
+    Result.val = -1;
+
+    SimdLane lane;
+    uint8_t* data;
+    size_t count;
+    SimdMapOp op;
+    const char* name = YYGetString(arg, 3);
+    if (!simd_map_op(name, op))
+    {
+        LOG_ERROR("Unknown buffer map op: " << name);
+        return;
+    }
+    if (!simd_range(argc, arg, 6, lane, data, count)) return;
+
+    simd().map(data, count, lane, op, YYGetReal(arg, 4), YYGetReal(arg, 5));
+    Result.val = (double)count;
+}
+
+// interop_buffer_reduce(buffer, size, type, op, [offset], [count]), op is sum, min or max
+YYEXPORT void interop_buffer_reduce(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    Result.kind = VALUE_REAL;
+    Result.val = 0;
+
+    SimdLane lane;
+    uint8_t* data;
+    size_t count;
+    SimdReduceOp op;
+    const char* name = YYGetString(arg, 3);
+    if (std::strcmp(name, "sum") == 0) op = SimdReduceOp::Sum;
+    else if (std::strcmp(name, "min") == 0) op = SimdReduceOp::Min;
+    else if (std::strcmp(name, "max") == 0) op = SimdReduceOp::Max;
+    else
+    {
+        LOG_ERROR("Unknown buffer reduce op: " << name);
+        return;
+    }
+    if (!simd_range(argc, arg, 4, lane, data, count)) return;
+
+    Result.val = simd().reduce(data, count, lane, op);
+}
+
+// interop_buffer_scan(buffer, size, type, [offset], [count]), inclusive prefix sum in place
+YYEXPORT void interop_buffer_scan(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    Result.kind = VALUE_REAL;
+    Result.val = -1;
+
+    SimdLane lane;
+    uint8_t* data;
+    size_t count;
+    if (!simd_range(argc, arg, 3, lane, data, count)) return;
+
+    simd().scan(data, count, lane);
+    Result.val = (double)count;
+}
+
+// interop_buffer_filter(buffer, size, type, cmp, value, [offset], [count]), cmp is <, <=, >, >=, == or !=
+// returns how many elements were kept, they're packed at offset in their original order
+YYEXPORT void interop_buffer_filter(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    Result.kind = VALUE_REAL;
+    Result.val = -1;
+
+    SimdLane lane;
+    uint8_t* data;
+    size_t count;
+    SimdCmp cmp;
+    const char* name = YYGetString(arg, 3);
+    if (!simd_cmp(name, cmp))
+    {
+        LOG_ERROR("Unknown buffer filter comparison: " << name);
+        return;
+    }
+    if (!simd_range(argc, arg, 5, lane, data, count)) return;
+
+    Result.val = (double)simd().filter(data, count, lane, cmp, YYGetReal(arg, 4));
+}
+
+// interop_simd_level([level]), 0 scalar, 1 sse2, 2 avx2. Passing a level caps the kernels at it (for comparing them),
+// returns the level in use
+YYEXPORT void interop_simd_level(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    if (argc > 0)
+    {
+        int level = YYGetInt32(arg, 0);
+        simdLevel = level < SIMD_SCALAR ? SIMD_SCALAR : (level > simdSupported ? simdSupported : level);
+    }
+    Result.kind = VALUE_REAL;
+    Result.val = simdLevel;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Batch kernels over GML buffers, working in place on f32 / f64 / s32 lanes. There's one table per instruction
+// set, simd.cpp picks the best one the cpu supports at startup.
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#else
+#define SIMD_X86 0
+#endif
+
+enum class SimdLane : uint8_t
+{
+    F32,
+    F64,
+    I32
+};
+
+enum class SimdMapOp : uint8_t
+{
+    Add,    // x + a
+    Mul,    // x * a
+    Fma,    // x * a + b, not fused so every instruction set rounds the same way
+    Min,    // min(x, a)
+    Max,    // max(x, a)
+    Clamp,  // min(max(x, a), b)
+    Abs
+};
+
+enum class SimdReduceOp : uint8_t
+{
+    Sum,
+    Min,
+    Max
+};
+
+enum class SimdCmp : uint8_t
+{
+    Lt,
+    Le,
+    Gt,
+    Ge,
+    Eq,
+    Ne
+};
+
+enum SimdLevel
+{
+    SIMD_SCALAR = 0,
+    SIMD_SSE2 = 1,
+    SIMD_AVX2 = 2
+};
+
+struct SimdKernels
+{
+    void (*map)(void* data, size_t count, SimdLane lane, SimdMapOp op, double a, double b);
+    // sums widen to double (f32) or int64 (s32) before they're added up
+    double (*reduce)(const void* data, size_t count, SimdLane lane, SimdReduceOp op);
+    // inclusive prefix sum, s32 wraps on overflow
+    void (*scan)(void* data, size_t count, SimdLane lane);
+    // moves the elements where `x cmp value` holds to the front, keeping their order, and returns how many there are
+    size_t (*filter)(void* data, size_t count, SimdLane lane, SimdCmp cmp, double value);
+};
+
+extern const SimdKernels simdScalar;
+#if SIMD_X86
+extern const SimdKernels simdSse2;
+extern const SimdKernels simdAvx2;
+#endif
@@ -0,0 +1,238 @@
+#include "simd_kernels.h"
+
+// built with avx2 code generation (see CMakeLists.txt), only ever called after simd.cpp checked the cpu
+
+#if SIMD_X86
+
+#include <immintrin.h>
+
+// permutevar8x32 indices that pack the selected 32 bit lanes to the front, by movemask. Built at compile time,
+// code from this file can't run during static initialisation on a cpu without avx2
+struct CompressTable
+{
+    alignas(8) uint8_t lanes32[256][8] = {};
+    alignas(8) uint8_t lanes64[16][8] = {};
+    uint8_t count32[256] = {};
+    uint8_t count64[16] = {};
+
+    constexpr CompressTable()
+    {
+        for (unsigned mask = 0; mask < 256; mask++)
+        {
+            uint8_t k = 0;
+            for (uint8_t lane = 0; lane < 8; lane++)
+            {
+                if (mask & (1u << lane)) lanes32[mask][k++] = lane;
+            }
+            count32[mask] = k;
+            while (k < 8) lanes32[mask][k++] = 0;
+        }
+
+        for (unsigned mask = 0; mask < 16; mask++)
+        {
+            uint8_t k = 0;
+            for (uint8_t lane = 0; lane < 4; lane++)
+            {
+                if (mask & (1u << lane))
+                {
+                    lanes64[mask][k++] = lane * 2;
+                    lanes64[mask][k++] = lane * 2 + 1;
+                }
+            }
+            count64[mask] = k / 2;
+            while (k < 8) lanes64[mask][k++] = 0;
+        }
+    }
+};
+
+static constexpr CompressTable compressTable;
+
+static __m256i compress_indices(const uint8_t* lanes)
+{
+    return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)lanes));
+}
+
+template <SimdCmp C>
+static constexpr int avx2_predicate()
+{
+    if constexpr (C == SimdCmp::Lt) return _CMP_LT_OQ;
+    else if constexpr (C == SimdCmp::Le) return _CMP_LE_OQ;
+    else if constexpr (C == SimdCmp::Gt) return _CMP_GT_OQ;
+    else if constexpr (C == SimdCmp::Ge) return _CMP_GE_OQ;
+    else if constexpr (C == SimdCmp::Eq) return _CMP_EQ_OQ;
+    else return _CMP_NEQ_UQ;
+}
+
+struct Avx2F32
+{
+    using Type = float;
+    using Reg = __m256;
+    static constexpr size_t N = 8;
+
+    static Reg load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, Reg x) { _mm256_storeu_ps(p, x); }
+    static Reg set1(float x) { return _mm256_set1_ps(x); }
+    static Reg add(Reg a, Reg b) { return _mm256_add_ps(a, b); }
+    static Reg mul(Reg a, Reg b) { return _mm256_mul_ps(a, b); }
+    static Reg min(Reg a, Reg b) { return _mm256_min_ps(a, b); }
+    static Reg max(Reg a, Reg b) { return _mm256_max_ps(a, b); }
+    static Reg abs(Reg a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+
+    // byte shifts stay inside each 128 bit half, so scan the halves then add the low half's total to the high one
+    static Reg scan(Reg x)
+    {
+        x = _mm256_add_ps(x, _mm256_castsi256_ps(_mm256_slli_si256(_mm256_castps_si256(x), 4)));
+        x = _mm256_add_ps(x, _mm256_castsi256_ps(_mm256_slli_si256(_mm256_castps_si256(x), 8)));
+        Reg total = _mm256_shuffle_ps(x, x, _MM_SHUFFLE(3, 3, 3, 3));
+        return _mm256_add_ps(x, _mm256_permute2f128_ps(total, total, 0x08));
+    }
+
+    static Reg last(Reg x)
+    {
+        Reg total = _mm256_shuffle_ps(x, x, _MM_SHUFFLE(3, 3, 3, 3));
+        return _mm256_permute2f128_ps(total, total, 0x11);
+    }
+
+    static double sum(const float* p, size_t n)
+    {
+        __m256d low = _mm256_setzero_pd(), high = _mm256_setzero_pd();
+        for (size_t i = 0; i < n; i += N)
+        {
+            Reg x = _mm256_loadu_ps(p + i);
+            low = _mm256_add_pd(low, _mm256_cvtps_pd(_mm256_castps256_ps128(x)));
+            high = _mm256_add_pd(high, _mm256_cvtps_pd(_mm256_extractf128_ps(x, 1)));
+        }
+        double lanes[4];
+        _mm256_storeu_pd(lanes, _mm256_add_pd(low, high));
+        return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    }
+
+    template <SimdCmp C>
+    static unsigned mask(Reg x, Reg v)
+    {
+        // through a constexpr local, without optimisation gcc's cmp macro won't take the call as an immediate
+        constexpr int predicate = avx2_predicate<C>();
+        return _mm256_movemask_ps(_mm256_cmp_ps(x, v, predicate));
+    }
+
+    static float* compress(float* out, Reg x, unsigned mask)
+    {
+        _mm256_storeu_ps(out, _mm256_permutevar8x32_ps(x, compress_indices(compressTable.lanes32[mask])));
+        return out + compressTable.count32[mask];
+    }
+};
+
+struct Avx2F64
+{
+    using Type = double;
+    using Reg = __m256d;
+    static constexpr size_t N = 4;
+
+    static Reg load(const double* p) { return _mm256_loadu_pd(p); }
+    static void store(double* p, Reg x) { _mm256_storeu_pd(p, x); }
+    static Reg set1(double x) { return _mm256_set1_pd(x); }
+    static Reg add(Reg a, Reg b) { return _mm256_add_pd(a, b); }
+    static Reg mul(Reg a, Reg b) { return _mm256_mul_pd(a, b); }
+    static Reg min(Reg a, Reg b) { return _mm256_min_pd(a, b); }
+    static Reg max(Reg a, Reg b) { return _mm256_max_pd(a, b); }
+    static Reg abs(Reg a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+
+    static Reg scan(Reg x)
+    {
+        x = _mm256_add_pd(x, _mm256_castsi256_pd(_mm256_slli_si256(_mm256_castpd_si256(x), 8)));
+        Reg total = _mm256_permute4x64_pd(x, _MM_SHUFFLE(1, 1, 1, 1));
+        return _mm256_add_pd(x, _mm256_blend_pd(_mm256_setzero_pd(), total, 0xC));
+    }
+
+    static Reg last(Reg x) { return _mm256_permute4x64_pd(x, _MM_SHUFFLE(3, 3, 3, 3)); }
+
+    static double sum(const double* p, size_t n)
+    {
+        __m256d acc = _mm256_setzero_pd();
+        for (size_t i = 0; i < n; i += N) acc = _mm256_add_pd(acc, _mm256_loadu_pd(p + i));
+        double lanes[4];
+        _mm256_storeu_pd(lanes, acc);
+        return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    }
+
+    template <SimdCmp C>
+    static unsigned mask(Reg x, Reg v)
+    {
+        constexpr int predicate = avx2_predicate<C>();
+        return _mm256_movemask_pd(_mm256_cmp_pd(x, v, predicate));
+    }
+
+    static double* compress(double* out, Reg x, unsigned mask)
+    {
+        __m256 packed = _mm256_permutevar8x32_ps(_mm256_castpd_ps(x), compress_indices(compressTable.lanes64[mask]));
+        _mm256_storeu_ps((float*)out, packed);
+        return out + compressTable.count64[mask];
+    }
+};
+
+struct Avx2I32
+{
+    using Type = int32_t;
+    using Reg = __m256i;
+    static constexpr size_t N = 8;
+
+    static Reg load(const int32_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+    static void store(int32_t* p, Reg x) { _mm256_storeu_si256((__m256i*)p, x); }
+    static Reg set1(int32_t x) { return _mm256_set1_epi32(x); }
+    static Reg add(Reg a, Reg b) { return _mm256_add_epi32(a, b); }
+    static Reg mul(Reg a, Reg b) { return _mm256_mullo_epi32(a, b); }
+    static Reg min(Reg a, Reg b) { return _mm256_min_epi32(a, b); }
+    static Reg max(Reg a, Reg b) { return _mm256_max_epi32(a, b); }
+    static Reg abs(Reg a) { return _mm256_abs_epi32(a); }
+
+    static Reg scan(Reg x)
+    {
+        x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+        x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+        Reg total = _mm256_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+        return _mm256_add_epi32(x, _mm256_permute2x128_si256(total, total, 0x08));
+    }
+
+    static Reg last(Reg x)
+    {
+        Reg total = _mm256_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+        return _mm256_permute2x128_si256(total, total, 0x11);
+    }
+
+    static double sum(const int32_t* p, size_t n)
+    {
+        __m256i acc = _mm256_setzero_si256();
+        for (size_t i = 0; i < n; i += N)
+        {
+            Reg x = load(p + i);
+            acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(x)));
+            acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(x, 1)));
+        }
+        int64_t lanes[4];
+        _mm256_storeu_si256((__m256i*)lanes, acc);
+        return (double)(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+    }
+
+    template <SimdCmp C>
+    static unsigned mask(Reg x, Reg v)
+    {
+        if constexpr (C == SimdCmp::Lt) return movemask(_mm256_cmpgt_epi32(v, x));
+        else if constexpr (C == SimdCmp::Le) return ~movemask(_mm256_cmpgt_epi32(x, v)) & 0xFF;
+        else if constexpr (C == SimdCmp::Gt) return movemask(_mm256_cmpgt_epi32(x, v));
+        else if constexpr (C == SimdCmp::Ge) return ~movemask(_mm256_cmpgt_epi32(v, x)) & 0xFF;
+        else if constexpr (C == SimdCmp::Eq) return movemask(_mm256_cmpeq_epi32(x, v));
+        else return ~movemask(_mm256_cmpeq_epi32(x, v)) & 0xFF;
+    }
+
+    static unsigned movemask(Reg x) { return (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(x)); }
+
+    static int32_t* compress(int32_t* out, Reg x, unsigned mask)
+    {
+        _mm256_storeu_si256((__m256i*)out, _mm256_permutevar8x32_epi32(x, compress_indices(compressTable.lanes32[mask])));
+        return out + compressTable.count32[mask];
+    }
+};
+
+const SimdKernels simdAvx2 = simd_kernels<Avx2F32, Avx2F64, Avx2I32>();
+
+#endif
@@ -0,0 +1,265 @@
+#pragma once
+
+#include "simd.h"
+#include <cmath>
+#include <type_traits>
+
+// Kernel bodies shared by every instruction set. A lane type L provides Type, Reg, N and the register operations,
+// the kernels run L over the whole registers and ScalarLanes over the tail. Everything is in an anonymous namespace
+// since simd_avx2.cpp instantiates these with different code generation flags than simd.cpp.
+
+namespace
+{
+
+template <SimdCmp C, typename T>
+inline bool simd_compare(T x, T value)
+{
+    if constexpr (C == SimdCmp::Lt) return x < value;
+    else if constexpr (C == SimdCmp::Le) return x <= value;
+    else if constexpr (C == SimdCmp::Gt) return x > value;
+    else if constexpr (C == SimdCmp::Ge) return x >= value;
+    else if constexpr (C == SimdCmp::Eq) return x == value;
+    else return x != value;
+}
+
+template <typename T>
+struct ScalarLanes
+{
+    using Type = T;
+    using Reg = T;
+    static constexpr size_t N = 1;
+
+    static Reg load(const T* p) { return *p; }
+    static void store(T* p, Reg x) { *p = x; }
+    static Reg set1(T x) { return x; }
+
+    static Reg add(Reg a, Reg b)
+    {
+        if constexpr (std::is_integral_v<T>) return (T)((uint32_t)a + (uint32_t)b);
+        else return a + b;
+    }
+
+    static Reg mul(Reg a, Reg b)
+    {
+        if constexpr (std::is_integral_v<T>) return (T)((uint32_t)a * (uint32_t)b);
+        else return a * b;
+    }
+
+    // same operand order as minps / maxps, so a NaN picks the same side on every instruction set
+    static Reg min(Reg a, Reg b) { return a < b ? a : b; }
+    static Reg max(Reg a, Reg b) { return a > b ? a : b; }
+
+    static Reg abs(Reg a)
+    {
+        if constexpr (std::is_integral_v<T>) return a < 0 ? (T)(0u - (uint32_t)a) : a;
+        else return std::fabs(a);
+    }
+
+    static Reg scan(Reg x) { return x; }
+    static Reg last(Reg x) { return x; }
+
+    template <SimdCmp C>
+    static unsigned mask(Reg x, Reg value) { return simd_compare<C>(x, value); }
+
+    static T* compress(T* out, Reg x, unsigned mask)
+    {
+        if (mask) *out++ = x;
+        return out;
+    }
+
+    static double sum(const T* p, size_t n)
+    {
+        if constexpr (std::is_integral_v<T>)
+        {
+            int64_t sum = 0;
+            for (size_t i = 0; i < n; i++) sum += p[i];
+            return (double)sum;
+        }
+        else
+        {
+            double sum = 0;
+            for (size_t i = 0; i < n; i++) sum += p[i];
+            return sum;
+        }
+    }
+};
+
+template <typename L, typename V, typename S>
+inline void map_loop(typename L::Type* p, size_t n, V vector, S scalar)
+{
+    size_t i = 0;
+    for (; i + L::N <= n; i += L::N) L::store(p + i, vector(L::load(p + i)));
+    for (; i < n; i++) p[i] = scalar(p[i]);
+}
+
+template <typename L>
+void map_kernel(typename L::Type* p, size_t n, SimdMapOp op, typename L::Type a, typename L::Type b)
+{
+    using T = typename L::Type;
+    using R = typename L::Reg;
+    using S = ScalarLanes<T>;
+    R va = L::set1(a), vb = L::set1(b);
+
+    switch (op)
+    {
+        case SimdMapOp::Add:
+            map_loop<L>(p, n, [&](R x) { return L::add(x, va); }, [&](T x) { return S::add(x, a); });
+            break;
+        case SimdMapOp::Mul:
+            map_loop<L>(p, n, [&](R x) { return L::mul(x, va); }, [&](T x) { return S::mul(x, a); });
+            break;
+        case SimdMapOp::Fma:
+            map_loop<L>(p, n, [&](R x) { return L::add(L::mul(x, va), vb); }, [&](T x) { return S::add(S::mul(x, a), b); });
+            break;
+        case SimdMapOp::Min:
+            map_loop<L>(p, n, [&](R x) { return L::min(x, va); }, [&](T x) { return S::min(x, a); });
+            break;
+        case SimdMapOp::Max:
+            map_loop<L>(p, n, [&](R x) { return L::max(x, va); }, [&](T x) { return S::max(x, a); });
+            break;
+        case SimdMapOp::Clamp:
+            map_loop<L>(p, n, [&](R x) { return L::min(L::max(x, va), vb); }, [&](T x) { return S::min(S::max(x, a), b); });
+            break;
+        case SimdMapOp::Abs:
+            map_loop<L>(p, n, [&](R x) { return L::abs(x); }, [&](T x) { return S::abs(x); });
+            break;
+    }
+}
+
+template <typename L>
+double reduce_kernel(const typename L::Type* p, size_t n, SimdReduceOp op)
+{
+    using T = typename L::Type;
+    using S = ScalarLanes<T>;
+    size_t body = n - n % L::N;
+
+    if (op == SimdReduceOp::Sum) return L::sum(p, body) + S::sum(p + body, n - body);
+    if (n == 0) return 0;
+
+    T result = p[0];
+    if (body)
+    {
+        typename L::Reg acc = L::load(p);
+        for (size_t i = L::N; i < body; i += L::N)
+            acc = op == SimdReduceOp::Min ? L::min(acc, L::load(p + i)) : L::max(acc, L::load(p + i));
+
+        T lanes[L::N];
+        L::store(lanes, acc);
+        result = lanes[0];
+        for (size_t i = 1; i < L::N; i++) result = op == SimdReduceOp::Min ? S::min(result, lanes[i]) : S::max(result, lanes[i]);
+    }
+    for (size_t i = body; i < n; i++) result = op == SimdReduceOp::Min ? S::min(result, p[i]) : S::max(result, p[i]);
+    return (double)result;
+}
+
+template <typename L>
+void scan_kernel(typename L::Type* p, size_t n)
+{
+    using T = typename L::Type;
+    using S = ScalarLanes<T>;
+
+    typename L::Reg carry = L::set1(0);
+    size_t i = 0;
+    for (; i + L::N <= n; i += L::N)
+    {
+        typename L::Reg x = L::add(L::scan(L::load(p + i)), carry);
+        L::store(p + i, x);
+        carry = L::last(x);
+    }
+
+    T running = i ? p[i - 1] : 0;
+    for (; i < n; i++)
+    {
+        running = S::add(running, p[i]);
+        p[i] = running;
+    }
+}
+
+template <typename L, SimdCmp C>
+size_t filter_loop(typename L::Type* p, size_t n, typename L::Type value)
+{
+    using T = typename L::Type;
+
+    // out never passes i, so a full register store at out only overwrites elements that were already loaded
+    T* out = p;
+    typename L::Reg v = L::set1(value);
+    size_t i = 0;
+    for (; i + L::N <= n; i += L::N)
+    {
+        typename L::Reg x = L::load(p + i);
+        out = L::compress(out, x, L::template mask<C>(x, v));
+    }
+    for (; i < n; i++)
+    {
+        if (simd_compare<C>(p[i], value)) *out++ = p[i];
+    }
+    return out - p;
+}
+
+template <typename L>
+size_t filter_kernel(typename L::Type* p, size_t n, SimdCmp cmp, typename L::Type value)
+{
+    switch (cmp)
+    {
+        case SimdCmp::Lt: return filter_loop<L, SimdCmp::Lt>(p, n, value);
+        case SimdCmp::Le: return filter_loop<L, SimdCmp::Le>(p, n, value);
+        case SimdCmp::Gt: return filter_loop<L, SimdCmp::Gt>(p, n, value);
+        case SimdCmp::Ge: return filter_loop<L, SimdCmp::Ge>(p, n, value);
+        case SimdCmp::Eq: return filter_loop<L, SimdCmp::Eq>(p, n, value);
+        default: return filter_loop<L, SimdCmp::Ne>(p, n, value);
+    }
+}
+
+// entry points with the SimdKernels signatures, one instantiation per instruction set
+
+template <typename F32, typename F64, typename I32>
+void simd_map(void* data, size_t count, SimdLane lane, SimdMapOp op, double a, double b)
+{
+    switch (lane)
+    {
+        case SimdLane::F32: map_kernel<F32>((float*)data, count, op, (float)a, (float)b); break;
+        case SimdLane::F64: map_kernel<F64>((double*)data, count, op, a, b); break;
+        case SimdLane::I32: map_kernel<I32>((int32_t*)data, count, op, (int32_t)a, (int32_t)b); break;
+    }
+}
+
+template <typename F32, typename F64, typename I32>
+double simd_reduce(const void* data, size_t count, SimdLane lane, SimdReduceOp op)
+{
+    switch (lane)
+    {
+        case SimdLane::F32: return reduce_kernel<F32>((const float*)data, count, op);
+        case SimdLane::F64: return reduce_kernel<F64>((const double*)data, count, op);
+        default: return reduce_kernel<I32>((const int32_t*)data, count, op);
+    }
+}
+
+template <typename F32, typename F64, typename I32>
+void simd_scan(void* data, size_t count, SimdLane lane)
+{
+    switch (lane)
+    {
+        case SimdLane::F32: scan_kernel<F32>((float*)data, count); break;
+        case SimdLane::F64: scan_kernel<F64>((double*)data, count); break;
+        case SimdLane::I32: scan_kernel<I32>((int32_t*)data, count); break;
+    }
+}
+
+template <typename F32, typename F64, typename I32>
+size_t simd_filter(void* data, size_t count, SimdLane lane, SimdCmp cmp, double value)
+{
+    switch (lane)
+    {
+        case SimdLane::F32: return filter_kernel<F32>((float*)data, count, cmp, (float)value);
+        case SimdLane::F64: return filter_kernel<F64>((double*)data, count, cmp, value);
+        default: return filter_kernel<I32>((int32_t*)data, count, cmp, (int32_t)value);
+    }
+}
+
+template <typename F32, typename F64, typename I32>
+constexpr SimdKernels simd_kernels()
+{
+    return { simd_map<F32, F64, I32>, simd_reduce<F32, F64, I32>, simd_scan<F32, F64, I32>, simd_filter<F32, F64, I32> };
+}
+
+}
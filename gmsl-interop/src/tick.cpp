@@ -0,0 +1,204 @@
+#include "interop.h"
+#include <mono/metadata/reflection.h>
+#include <mono/metadata/metadata.h>
+#include <mono/metadata/loader.h>
+#include <vector>
+#include <cstring>
+
+// Mods mark static void methods with [GmlTick] (or call GMSL.Tick.Register at runtime) and they all get run from
+// one interop_tick call per step, instead of every mod paying for its own interop call from a Step event.
+
+typedef void (*TickThunk)(MonoObject** exception);
+typedef void (*TickDelegate)();
+
+struct TickCallback
+{
+    std::string name;
+    TickThunk thunk;        // from mono_method_get_unmanaged_thunk, for [GmlTick] methods
+    TickDelegate delegate;  // from Marshal.GetFunctionPointerForDelegate, for Tick.Register
+    bool failed;
+    int64 lastTime;
+    int64 totalTime;
+    int64 maxTime;
+    uint64 calls;
+};
+
+std::vector<TickCallback> tickCallbacks;
+uint64 tickFrames = 0;
+
+static void tick_add(const std::string& name, TickThunk thunk, TickDelegate delegate)
+{
+    TickCallback callback = TickCallback();
+    callback.name = name;
+    callback.thunk = thunk;
+    callback.delegate = delegate;
+    tickCallbacks.push_back(callback);
+    LOG_INFO("Registered tick callback " << name);
+}
+
+static void tick_register_native(MonoString* name, void* callback)
+{
+    char* str = mono_string_to_utf8(name);
+    tick_add(str, NULL, (TickDelegate)callback);
+    mono_free(str);
+}
+
+void tick_init()
+{
+    mono_add_internal_call("GMSL.Tick::RegisterNative", (const void*)tick_register_native);
+}
+
+static bool tick_is_attribute(MonoClass* klass)
+{
+    return std::strcmp(mono_class_get_namespace(klass), "GMSL") == 0 && std::strcmp(mono_class_get_name(klass), "GmlTick") == 0;
+}
+
+void tick_discover(MonoImage* image, const std::string& mod)
+{
+    int rows = mono_image_get_table_rows(image, MONO_TABLE_TYPEDEF);
+    for (int i = 0; i < rows; i++)
+    {
+        MonoClass* klass = mono_class_get(image, MONO_TOKEN_TYPE_DEF | (i + 1));
+        if (!klass) continue;
+
+        void* iter = NULL;
+        while (MonoMethod* method = mono_class_get_methods(klass, &iter))
+        {
+            MonoCustomAttrInfo* attrs = mono_custom_attrs_from_method(method);
+            if (!attrs) continue;
+
+            for (int a = 0; a < attrs->num_attrs; a++)
+            {
+                MonoClass* attrClass = mono_method_get_class(attrs->attrs[a].ctor);
+                if (!tick_is_attribute(attrClass)) continue;
+
+                MonoMethodSignature* sig = mono_method_signature(method);
+                if (mono_signature_is_instance(sig) || mono_signature_get_param_count(sig) != 0 ||
+                    mono_type_get_type(mono_signature_get_return_type(sig)) != MONO_TYPE_VOID)
+                {
+                    LOG_ERROR("[GmlTick] method " << mono_method_get_name(method) << " in " << mod << " must be static void with no arguments");
+                    break;
+                }
+
+                std::string name = mono_method_get_name(method);
+                MonoObject* attr = mono_custom_attrs_get_attr(attrs, attrClass);
+                MonoClassField* nameField = attr ? mono_class_get_field_from_name(attrClass, "Name") : NULL;
+                if (nameField)
+                {
+                    MonoString* attrName = NULL;
+                    mono_field_get_value(attr, nameField, &attrName);
+                    if (attrName)
+                    {
+                        char* str = mono_string_to_utf8(attrName);
+                        name = str;
+                        mono_free(str);
+                    }
+                }
+
+                tick_add(mod + ":" + name, (TickThunk)mono_method_get_unmanaged_thunk(method), NULL);
+                break;
+            }
+
+            if (!attrs->cached) mono_custom_attrs_free(attrs);
+        }
+    }
+}
+
+YYEXPORT void interop_tick(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    tickFrames++;
+    gc_frame();
+
+    // a callback or scheduler job can call Tick.Register, which can move the vector, so this goes by index and
+    // anything registered during the tick first runs on the next one
+    size_t count = tickCallbacks.size();
+    for (size_t i = 0; i < count; i++)
+    {
+        if (tickCallbacks[i].failed) continue;
+
+        TickThunk thunk = tickCallbacks[i].thunk;
+        TickDelegate delegate = tickCallbacks[i].delegate;
+        MonoObject* exception = NULL;
+
+        int64 start = Timing_Time();
+        if (thunk) thunk(&exception);
+        else delegate();
+        int64 elapsed = Timing_Time() - start;
+
+        TickCallback& callback = tickCallbacks[i];
+        if (exception)
+        {
+            // a throwing callback would throw every frame, so it gets switched off after the first one
+            callback.failed = true;
+            MonoString* message = (MonoString*)mono_object_to_string(exception, NULL);
+            char* str = message ? mono_string_to_utf8(message) : NULL;
+            LOG_ERROR("tick callback " << callback.name << " threw, disabling it" << (str ? "\n" : "") << (str ? str : ""));
+            mono_free(str);
+        }
+
+        callback.lastTime = elapsed;
+        callback.totalTime += elapsed;
+        if (elapsed > callback.maxTime) callback.maxTime = elapsed;
+        callback.calls++;
+    }
+
+    scheduler_run();
+    kv_collect();
+
+    Result.kind = VALUE_REAL;
+    Result.val = (double)tickCallbacks.size();
+}
+
+YYEXPORT void interop_tick_count(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    Result.kind = VALUE_REAL;
+    Result.val = (double)tickCallbacks.size();
+}
+
+YYEXPORT void interop_tick_name(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    size_t index = (size_t)YYGetInt32(arg, 0);
+    YYCreateString(&Result, index < tickCallbacks.size() ? tickCallbacks[index].name.c_str() : "");
+}
+
+// last frame's time for a callback in microseconds, or the average over all frames when the second argument is true
+YYEXPORT void interop_tick_time(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    Result.kind = VALUE_REAL;
+    Result.val = 0;
+
+    size_t index = (size_t)YYGetInt32(arg, 0);
+    if (index >= tickCallbacks.size()) return;
+
+    TickCallback& callback = tickCallbacks[index];
+    if (argc > 1 && YYGetBool(arg, 1))
+        Result.val = callback.calls ? (double)callback.totalTime / callback.calls : 0;
+    else
+        Result.val = (double)callback.lastTime;
+}
+
+YYEXPORT void interop_tick_heaviest(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    const TickCallback* heaviest = NULL;
+    for (const TickCallback& callback : tickCallbacks)
+    {
+        if (!heaviest || callback.totalTime > heaviest->totalTime) heaviest = &callback;
+    }
+    YYCreateString(&Result, heaviest ? heaviest->name.c_str() : "");
+}
+
+YYEXPORT void interop_tick_report(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    Result.kind = VALUE_REAL;
+    Result.val = 1;
+
+    std::ostringstream report;
+    report << "Tick report over " << tickFrames << " frames (us, last / avg / max):";
+    for (const TickCallback& callback : tickCallbacks)
+    {
+        report << "\n  " << callback.name << " : " << callback.lastTime << " / "
+               << (callback.calls ? callback.totalTime / (int64)callback.calls : 0) << " / " << callback.maxTime
+               << (callback.failed ? " (disabled)" : "");
+    }
+    log_write(LogLevel::Info, report.str());
+}
@@ -0,0 +1,192 @@
+#include "interop.h"
+#include "trace.h"
+#include <mono/metadata/class.h>
+#include <mono/metadata/loader.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_map>
+
+// Capture side of the interop call traces (see trace.h for the format). Calls are encoded into memory and written
+// out in large blocks, so the per call cost is a clock read and a few bytes of varints.
+
+#define TRACE_FLUSH_SIZE (1 << 20)
+
+bool traceActive = false;
+static FILE* traceFile = NULL;
+static TraceWriter traceWriter;
+static std::unordered_map<const InteropBinding*, uint32_t> traceMethods;
+static uint64_t traceLastStart = 0;
+static uint64_t traceCalls = 0;
+
+uint64_t trace_now()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void trace_flush()
+{
+    if (!traceFile || traceWriter.bytes.empty()) return;
+    std::fwrite(traceWriter.bytes.data(), 1, traceWriter.bytes.size(), traceFile);
+    traceWriter.bytes.clear();
+}
+
+bool trace_start(const std::string& path)
+{
+    trace_stop();
+
+    traceFile = std::fopen(path.c_str(), "wb");
+    if (!traceFile)
+    {
+        LOG_ERROR("can't open interop trace " << path);
+        return false;
+    }
+
+    traceWriter.bytes.reserve(TRACE_FLUSH_SIZE + 4096);
+    traceWriter.u32(TRACE_MAGIC);
+    traceWriter.u32(TRACE_VERSION);
+    traceMethods.clear();
+    traceLastStart = trace_now();
+    traceCalls = 0;
+    traceActive = true;
+    LOG_INFO("Recording interop calls to " << path);
+    return true;
+}
+
+void trace_stop()
+{
+    if (!traceFile) return;
+
+    trace_flush();
+    std::fclose(traceFile);
+    traceFile = NULL;
+    traceActive = false;
+    LOG_INFO("Stopped interop trace after " << traceCalls << " calls");
+}
+
+// the replayer binds by name, so the method record carries the same strings interop_set_function takes
+static uint32_t trace_method(const InteropBinding* binding)
+{
+    auto found = traceMethods.find(binding);
+    if (found != traceMethods.end()) return found->second;
+
+    uint32_t id = (uint32_t)traceMethods.size();
+    traceMethods.emplace(binding, id);
+
+    MonoClass* klass = mono_method_get_class(binding->method);
+    MonoImage* image = mono_class_get_image(klass);
+    std::string dll;
+    for (const auto& mod : mods)
+    {
+        if (mod.second == image) dll = mod.first;
+    }
+
+    traceWriter.u8(TRACE_METHOD);
+    traceWriter.varint(id);
+    traceWriter.varint(mono_signature_get_param_count(mono_method_signature(binding->method)));
+    traceWriter.str(dll);
+    traceWriter.str(mono_class_get_namespace(klass));
+    traceWriter.str(mono_class_get_name(klass));
+    traceWriter.str(mono_method_get_name(binding->method));
+    return id;
+}
+
+void trace_call(const InteropBinding* binding, int argc, RValue* arg, uint64_t start, uint64_t end, bool failed)
+{
+    if (!binding || !binding->method) return;
+
+    uint32_t id = trace_method(binding);
+    traceWriter.u8(TRACE_CALL);
+    traceWriter.varint(id);
+    traceWriter.varint(start - traceLastStart);
+    traceWriter.varint(end - start);
+    traceWriter.u8((binding->fast && argc == binding->fastCall.argc ? TRACE_FAST : 0) | (failed ? TRACE_FAILED : 0));
+    traceWriter.varint((uint64_t)argc);
+    traceLastStart = start;
+
+    for (int i = 0; i < argc; i++)
+    {
+        switch (arg[i].kind & MASK_KIND_RVALUE)
+        {
+            case VALUE_REAL:
+                traceWriter.u8(TRACE_ARG_REAL);
+                traceWriter.f64(arg[i].val);
+                break;
+
+            case VALUE_BOOL:
+                traceWriter.u8(TRACE_ARG_BOOL);
+                traceWriter.f64(arg[i].val);
+                break;
+
+            case VALUE_INT32:
+                traceWriter.u8(TRACE_ARG_INT32);
+                traceWriter.svarint(arg[i].v32);
+                break;
+
+            case VALUE_INT64:
+                traceWriter.u8(TRACE_ARG_INT64);
+                traceWriter.svarint(arg[i].v64);
+                break;
+
+            case VALUE_STRING:
+            {
+                const char* str = arg[i].GetString();
+                traceWriter.u8(TRACE_ARG_STRING);
+                traceWriter.str(str, std::strlen(str));
+                break;
+            }
+
+            default:
+                traceWriter.u8(TRACE_ARG_OTHER);
+                break;
+        }
+    }
+
+    traceCalls++;
+    if (traceWriter.bytes.size() >= TRACE_FLUSH_SIZE) trace_flush();
+}
+
+// GMSL_TRACE=<file> records from startup, without any mod having to call interop_trace_start
+void trace_init()
+{
+    if (const char* path = std::getenv("GMSL_TRACE"))
+    {
+        if (*path) trace_start(path);
+    }
+}
+
+// interop_trace_start(path)
+YYEXPORT void interop_trace_start(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    Result.kind = VALUE_REAL;
+    Result.val = trace_start(YYGetString(arg, 0));
+}
+
+// interop_trace_stop(), returns how many calls were recorded
+YYEXPORT void interop_trace_stop(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg)
+{
+    uint64_t calls = traceCalls;
+    trace_stop();
+    Result.kind = VALUE_REAL;
+    Result.val = (double)calls;
+}
+
+static struct TraceExit
+{
+    ~TraceExit()
+    {
+        trace_flush();
+        if (traceFile) std::fclose(traceFile);
+        traceFile = NULL;
+    }
+} traceExit;
+
+YYEXPORT void YYExtensionInitialise(const struct YYRunnerInterface* _pFunctions, size_t _functions_size);
+YYEXPORT void interop_set_function(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg);
+YYEXPORT void interop_function(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg);
+
+extern "C" YYEXPORT const TraceReplayApi* interop_replay_api()
+{
+    static const TraceReplayApi api = { YYExtensionInitialise, interop_set_function, interop_function };
+    return &api;
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Interop call traces, captured by trace.cpp and replayed by gmsl-replay. Shared by both so it only depends on the
+// standard library. Layout, integers are LEB128 varints unless noted:
+//   u32 magic "GMTR", u32 version
+//   method: u8 TRACE_METHOD, id, argc, dll, namespace, class, method (strings are length + utf8)
+//   call:   u8 TRACE_CALL, method id, start (ns since the previous call's start), duration ns, u8 flags, argc,
+//           then per argument a u8 TraceArg and its value (f64 for reals and bools, zigzag varint for ints,
+//           string for strings, nothing otherwise)
+
+#define TRACE_MAGIC 0x52544d47 // "GMTR"
+#define TRACE_VERSION 1
+
+enum TraceRecord : uint8_t
+{
+    TRACE_METHOD = 1,
+    TRACE_CALL = 2
+};
+
+enum TraceArg : uint8_t
+{
+    TRACE_ARG_REAL,
+    TRACE_ARG_STRING,
+    TRACE_ARG_BOOL,
+    TRACE_ARG_INT32,
+    TRACE_ARG_INT64,
+    TRACE_ARG_OTHER
+};
+
+enum TraceFlags : uint8_t
+{
+    TRACE_FAST = 1,    // went through the unmanaged thunk
+    TRACE_FAILED = 2   // threw or couldn't convert an argument / the result
+};
+
+struct TraceWriter
+{
+    std::vector<uint8_t> bytes;
+
+    void u8(uint8_t value) { bytes.push_back(value); }
+
+    void u32(uint32_t value)
+    {
+        for (int i = 0; i < 4; i++) bytes.push_back((uint8_t)(value >> (i * 8)));
+    }
+
+    void varint(uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            bytes.push_back((uint8_t)(value | 0x80));
+            value >>= 7;
+        }
+        bytes.push_back((uint8_t)value);
+    }
+
+    void svarint(int64_t value) { varint(((uint64_t)value << 1) ^ (uint64_t)(value >> 63)); }
+
+    void f64(double value)
+    {
+        uint8_t raw[8];
+        std::memcpy(raw, &value, 8);
+        bytes.insert(bytes.end(), raw, raw + 8);
+    }
+
+    void str(const char* value, size_t length)
+    {
+        varint(length);
+        bytes.insert(bytes.end(), (const uint8_t*)value, (const uint8_t*)value + length);
+    }
+
+    void str(const std::string& value) { str(value.data(), value.size()); }
+};
+
+// reads past the end set `failed` and return zeroes, so a truncated trace just stops at the last whole record
+struct TraceReader
+{
+    const uint8_t* cursor;
+    const uint8_t* end;
+    bool failed = false;
+
+    bool done() const { return failed || cursor >= end; }
+
+    uint8_t u8()
+    {
+        if (cursor >= end) return fail();
+        return *cursor++;
+    }
+
+    uint32_t u32()
+    {
+        if (end - cursor < 4) return fail();
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++) value |= (uint32_t)*cursor++ << (i * 8);
+        return value;
+    }
+
+    uint64_t varint()
+    {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            if (cursor >= end) return fail();
+            uint8_t byte = *cursor++;
+            value |= (uint64_t)(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        return fail();
+    }
+
+    int64_t svarint()
+    {
+        uint64_t value = varint();
+        return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+    }
+
+    double f64()
+    {
+        if (end - cursor < 8) return (double)fail();
+        double value;
+        std::memcpy(&value, cursor, 8);
+        cursor += 8;
+        return value;
+    }
+
+    std::string str()
+    {
+        uint64_t length = varint();
+        if ((uint64_t)(end - cursor) < length) return fail(), std::string();
+        std::string value((const char*)cursor, (size_t)length);
+        cursor += length;
+        return value;
+    }
+
+    uint8_t fail()
+    {
+        failed = true;
+        cursor = end;
+        return 0;
+    }
+};
+
+struct RValue;
+class CInstance;
+struct YYRunnerInterface;
+
+typedef void (*TraceInitialise)(const YYRunnerInterface* functions, size_t size);
+typedef void (*TraceFunction)(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg);
+
+// exported unmangled as interop_replay_api, the YYEXPORT functions themselves are c++ symbols
+struct TraceReplayApi
+{
+    TraceInitialise initialise;
+    TraceFunction setFunction;
+    TraceFunction function;
+};
@@ -2,11 +2,11 @@
 
 #include "windows.h"
 #include <filesystem>
-#include <iostream>
 #include <shellapi.h>
 #include <fstream>
 #include <fcntl.h>
 #include <io.h>
+#include "gmsl-log.h"
 
 // https://github.com/cgytrus/gmml/blob/main/gmml/src/dllmain.cpp#L26
 constexpr auto PROXY_DLL = TEXT("version.dll");
@@ -29,7 +29,7 @@ std::filesystem::path getSystemDirectory()
 {
     wchar_t SystemDirectoryPath[MAX_PATH] = {0};
     if (!GetSystemDirectoryW(SystemDirectoryPath, MAX_PATH))
-        std::cout << "GetSystemDirectoryW fails: " << GetLastError() << std::endl;
+        LOG_ERROR("GetSystemDirectoryW fails: " << GetLastError());
     return SystemDirectoryPath;
 }
 
@@ -57,17 +57,17 @@ void RunPatcher()
         DWORD length = GetModuleFileName(hModule, path, MAX_PATH);
         if (length > 0 && length < MAX_PATH)
         {
-            std::cout << "Found game path: " << path << std::endl;
+            LOG_INFO("Found game path: " << path);
         }
         else
         {
-            std::cout << "Error: Unable to retrieve the path." << std::endl;
+            LOG_ERROR("Unable to retrieve the path.");
             return;
         }
     }
     else
     {
-        std::cout << "Error: Unable to get the module handle." << std::endl;
+        LOG_ERROR("Unable to get the module handle.");
         return;
     }
 
@@ -84,7 +84,7 @@ void RunPatcher()
     }
     else
     {
-        std::cerr << "Memory allocation failed." << std::endl;
+        LOG_ERROR("Memory allocation failed.");
     }
 
     std::filesystem::path gameFile = path;
@@ -100,7 +100,7 @@ void RunPatcher()
 
     if (error == 0)
     {
-        std::cout << "Error in CreateProcess: " << GetLastError() << std::endl;
+        LOG_ERROR("Error in CreateProcess: " << GetLastError());
     }
     else
     {
@@ -114,8 +114,10 @@ void RunPatcher()
 DWORD WINAPI Loader(LPVOID lpParam)
 {
     SuspendThread(lpParam);
+    log_init("gmsl/logs/loader.log");
     RunPatcher();
     ResumeThread(lpParam);
+    log_shutdown();
     exit(0);
     return 0;
 }
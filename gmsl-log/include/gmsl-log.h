@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <sstream>
+#include <string>
+
+// Shared logging backend for the loader and gmsl-interop. log_write only copies the message into a ring buffer owned
+// by the calling thread, a background thread does the console / file output, so logging never waits on a flush.
+
+enum class LogLevel : uint8_t
+{
+    Debug,
+    Info,
+    Warning,
+    Error,
+    None
+};
+
+// per thread ring size, a thread that fills its ring before the next drain loses messages instead of blocking
+#define LOG_RING_SIZE (64 * 1024)
+#define LOG_MAX_MESSAGE 8192
+// every thread can burst this many messages, then gets refilled at LOG_RATE_PER_SECOND
+#define LOG_RATE_BURST 256
+#define LOG_RATE_PER_SECOND 64
+
+void log_init(const std::filesystem::path& file, LogLevel level = LogLevel::Info);
+void log_shutdown();
+void log_flush();
+void log_set_level(LogLevel level);
+bool log_enabled(LogLevel level);
+void log_write(LogLevel level, const char* message, size_t length);
+
+inline void log_write(LogLevel level, const std::string& message)
+{
+    log_write(level, message.data(), message.size());
+}
+
+#define GMSL_LOG(level, message)                         \
+    do                                                   \
+    {                                                    \
+        if (log_enabled(level))                          \
+        {                                                \
+            std::ostringstream gmsl_log_stream;          \
+            gmsl_log_stream << message;                  \
+            log_write(level, gmsl_log_stream.str());     \
+        }                                                \
+    } while (0)
+
+#define LOG_DEBUG(message) GMSL_LOG(LogLevel::Debug, message)
+#define LOG_INFO(message) GMSL_LOG(LogLevel::Info, message)
+#define LOG_WARN(message) GMSL_LOG(LogLevel::Warning, message)
+#define LOG_ERROR(message) GMSL_LOG(LogLevel::Error, message)
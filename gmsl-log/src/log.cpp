@@ -0,0 +1,268 @@
+#include "gmsl-log.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct LogHeader
+{
+    uint64_t time;
+    uint32_t length;
+    LogLevel level;
+};
+
+// single producer (the owning thread) / single consumer (the drain) ring, positions only ever grow
+struct LogRing
+{
+    std::atomic<uint64_t> head{0};
+    std::atomic<uint64_t> tail{0};
+    std::atomic<uint64_t> dropped{0};
+    double tokens = LOG_RATE_BURST;
+    uint64_t refilled = 0;
+    char data[LOG_RING_SIZE];
+};
+
+struct LogEntry
+{
+    uint64_t time;
+    LogLevel level;
+    std::string text;
+};
+
+static std::atomic<LogLevel> logLevel(LogLevel::Info);
+static std::atomic<bool> logRunning(false);
+static std::atomic<bool> logStopped(true);
+static std::once_flag logStarted;
+
+// rings are never freed, a thread that exits just leaves its (drained) ring behind. Neither is the list, the drain
+// thread can still be walking it while statics are destroyed
+static std::mutex logRingsMutex;
+static std::vector<LogRing*>& logRings = *new std::vector<LogRing*>();
+
+// held for a whole drain so the background thread and log_flush don't interleave lines
+static std::mutex logDrainMutex;
+static FILE* logFile = NULL;
+
+static const std::chrono::steady_clock::time_point logEpoch = std::chrono::steady_clock::now();
+
+static uint64_t log_now()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - logEpoch).count();
+}
+
+static bool log_drain();
+
+static void log_thread()
+{
+    while (logRunning.load(std::memory_order_acquire))
+    {
+        if (!log_drain()) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    logStopped.store(true, std::memory_order_release);
+}
+
+static void log_start()
+{
+    logStopped.store(false, std::memory_order_relaxed);
+    logRunning.store(true, std::memory_order_release);
+    // detached, joining from a static destructor or DLL detach can deadlock on windows
+    std::thread(log_thread).detach();
+}
+
+static LogRing* log_ring()
+{
+    thread_local LogRing* ring = NULL;
+    if (ring) return ring;
+
+    std::call_once(logStarted, log_start);
+    ring = new LogRing();
+    ring->refilled = log_now();
+    std::lock_guard<std::mutex> lock(logRingsMutex);
+    logRings.push_back(ring);
+    return ring;
+}
+
+static void log_ring_write(LogRing* ring, uint64_t position, const void* source, size_t length)
+{
+    size_t offset = position % LOG_RING_SIZE;
+    size_t first = std::min(length, (size_t)LOG_RING_SIZE - offset);
+    std::memcpy(ring->data + offset, source, first);
+    std::memcpy(ring->data, (const char*)source + first, length - first);
+}
+
+static void log_ring_read(const LogRing* ring, uint64_t position, void* destination, size_t length)
+{
+    size_t offset = position % LOG_RING_SIZE;
+    size_t first = std::min(length, (size_t)LOG_RING_SIZE - offset);
+    std::memcpy(destination, ring->data + offset, first);
+    std::memcpy((char*)destination + first, ring->data, length - first);
+}
+
+bool log_enabled(LogLevel level)
+{
+    return level >= logLevel.load(std::memory_order_relaxed) && level != LogLevel::None;
+}
+
+void log_set_level(LogLevel level)
+{
+    logLevel.store(level, std::memory_order_relaxed);
+}
+
+void log_write(LogLevel level, const char* message, size_t length)
+{
+    if (!log_enabled(level)) return;
+
+    LogRing* ring = log_ring();
+    uint64_t now = log_now();
+
+    ring->tokens = std::min((double)LOG_RATE_BURST, ring->tokens + (double)(now - ring->refilled) * LOG_RATE_PER_SECOND / 1e9);
+    ring->refilled = now;
+    if (ring->tokens < 1)
+    {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    ring->tokens -= 1;
+
+    LogHeader header = { now, (uint32_t)std::min(length, (size_t)LOG_MAX_MESSAGE), level };
+    size_t size = sizeof(header) + header.length;
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    uint64_t tail = ring->tail.load(std::memory_order_acquire);
+    if (LOG_RING_SIZE - (head - tail) < size)
+    {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    log_ring_write(ring, head, &header, sizeof(header));
+    log_ring_write(ring, head + sizeof(header), message, header.length);
+    ring->head.store(head + size, std::memory_order_release);
+}
+
+static const char* log_level_prefix(LogLevel level)
+{
+    switch (level)
+    {
+        case LogLevel::Debug: return "[VSLoader] DEBUG : ";
+        case LogLevel::Warning: return "[VSLoader] WARNING : ";
+        case LogLevel::Error: return "[VSLoader] ERROR : ";
+        default: return "[VSLoader] ";
+    }
+}
+
+// returns whether anything was written
+static bool log_drain_locked()
+{
+    std::vector<LogRing*> rings;
+    {
+        std::lock_guard<std::mutex> lock(logRingsMutex);
+        rings = logRings;
+    }
+
+    std::vector<LogEntry> entries;
+    for (LogRing* ring : rings)
+    {
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        while (tail < head)
+        {
+            LogHeader header;
+            log_ring_read(ring, tail, &header, sizeof(header));
+            LogEntry entry = { header.time, header.level, std::string(header.length, '\0') };
+            log_ring_read(ring, tail + sizeof(header), &entry.text[0], header.length);
+            entries.push_back(std::move(entry));
+            tail += sizeof(header) + header.length;
+        }
+        ring->tail.store(tail, std::memory_order_release);
+
+        uint64_t dropped = ring->dropped.exchange(0, std::memory_order_relaxed);
+        if (dropped) entries.push_back({ log_now(), LogLevel::Warning, "dropped " + std::to_string(dropped) + " log message(s)" });
+    }
+
+    if (entries.empty()) return false;
+
+    // every ring is in order on its own, interleave the threads by time
+    std::stable_sort(entries.begin(), entries.end(), [](const LogEntry& a, const LogEntry& b) { return a.time < b.time; });
+    for (const LogEntry& entry : entries)
+    {
+        const char* prefix = log_level_prefix(entry.level);
+        std::fputs(prefix, stdout);
+        std::fwrite(entry.text.data(), 1, entry.text.size(), stdout);
+        std::fputc('\n', stdout);
+
+        if (logFile)
+        {
+            std::fprintf(logFile, "[%10.3f] %s", entry.time / 1e9, prefix);
+            std::fwrite(entry.text.data(), 1, entry.text.size(), logFile);
+            std::fputc('\n', logFile);
+        }
+    }
+
+    std::fflush(stdout);
+    if (logFile) std::fflush(logFile);
+    return true;
+}
+
+static bool log_drain()
+{
+    std::lock_guard<std::mutex> lock(logDrainMutex);
+    return log_drain_locked();
+}
+
+void log_init(const std::filesystem::path& file, LogLevel level)
+{
+    log_set_level(level);
+    log_ring();
+
+    std::error_code error;
+    std::filesystem::create_directories(file.parent_path(), error);
+
+    std::lock_guard<std::mutex> lock(logDrainMutex);
+    if (logFile) std::fclose(logFile);
+    logFile = std::fopen(file.string().c_str(), "w");
+    if (!logFile) std::fprintf(stdout, "[VSLoader] WARNING : can't open log file %s\n", file.string().c_str());
+}
+
+void log_flush()
+{
+    // the drain thread might have been killed mid drain on process exit, don't wait on it then
+    std::unique_lock<std::mutex> lock(logDrainMutex, std::try_to_lock);
+    if (!lock.owns_lock())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        if (!lock.try_lock()) return;
+    }
+    for (int i = 0; i < 16 && log_drain_locked(); i++);
+}
+
+static void log_stop(int attempts)
+{
+    logRunning.store(false, std::memory_order_release);
+    for (int i = 0; i < attempts && !logStopped.load(std::memory_order_acquire); i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+}
+
+void log_shutdown()
+{
+    log_stop(100);
+    log_flush();
+
+    std::lock_guard<std::mutex> lock(logDrainMutex);
+    if (logFile) std::fclose(logFile);
+    logFile = NULL;
+}
+
+// whatever is still buffered when the module goes away
+static struct LogExit
+{
+    ~LogExit()
+    {
+        // a live drain thread stops within one pass, on windows process exit it's already been killed
+        log_stop(10);
+        log_flush();
+    }
+} logExit;
@@ -31,6 +31,9 @@ public abstract class GMSLMod
 		if (Path.Exists(scriptsDir)) {
 			Logger.Logger.Info($"Loading scripts from {scriptsDir}");
 			LoadCodeFromFiles(scriptsDir);
+
+			// decode any cached compiles up front on all cores, they get linked into the data as the mod uses them
+			GmlCache.Prefetch(scripts.Values);
 		}
 	}
 
@@ -38,6 +41,7 @@ public abstract class GMSLMod
 	{
 		Logger.Logger.Info("Finalizing mod");
 		moddingData.FinalizeHooks();
+		GmlCache.ReleasePrefetched();
 	}
 
 	public UndertaleGameObject NewObject(string objectName, UndertaleSprite sprite = null, bool visible = true, bool solid = false, bool persistent = false, UndertaleGameObject parentObject = null)
@@ -54,7 +58,7 @@ public abstract class GMSLMod
 		};
 
 		moddingData.Strings.Add(name);
-		moddingData.GameObjects.Add(newObject);
+		moddingData.GameObjects.AddIndexed(newObject);
 
 		return newObject;
 	}
@@ -83,35 +87,35 @@ public abstract class GMSLMod
 
 	public UndertaleGameObject GetObjectFromData(string name)
 	{
-		return moddingData.GameObjects.ByName(name);
+		return moddingData.GameObjects.ByNameIndexed(name);
 	}
 	public UndertaleSprite GetSpriteFromData(string name)
 	{
-		return moddingData.Sprites.ByName(name);
+		return moddingData.Sprites.ByNameIndexed(name);
 	}
 	public UndertaleRoom GetRoomFromData(string name)
 	{
-		return moddingData.Rooms.ByName(name);
+		return moddingData.Rooms.ByNameIndexed(name);
 	}
 	public UndertaleCode GetObjectCodeFromData(string name)
 	{
-		return moddingData.Code.ByName(name);
+		return moddingData.Code.ByNameIndexed(name);
 	}
 	public UndertaleFunction GetFunctionFromData(string name)
 	{
-		return moddingData.Functions.ByName(name);
+		return moddingData.Functions.ByNameIndexed(name);
 	}
 	public UndertaleScript GetScriptFromData(string name)
 	{
-		return moddingData.Scripts.ByName(name);
+		return moddingData.Scripts.ByNameIndexed(name);
 	}
 	public UndertaleSound GetSoundFromData(string name)
 	{
-		return moddingData.Sounds.ByName(name);
+		return moddingData.Sounds.ByNameIndexed(name);
 	}
 	public UndertaleVariable GetVariableFromData(string name)
 	{
-		return moddingData.Variables.ByName(name);
+		return moddingData.Variables.ByNameIndexed(name);
 	}
 
 
@@ -161,12 +165,12 @@ public abstract class GMSLMod
 	public void CreateObjectCodeFromFile(string path, string objName, EventType eventType)
 	{
 		string value = "";
-		UndertaleGameObject obj = moddingData.GameObjects.ByName(objName);
+		UndertaleGameObject obj = moddingData.GameObjects.ByNameIndexed(objName);
 
 		if (scripts.TryGetValue(path, out value))
 		{
 			obj.EventHandlerFor(eventType, moddingData)
-			.ReplaceGmlSafe(value, moddingData);
+			.ReplaceGmlCached(value, moddingData);
 		}
 		else
 		{
@@ -177,12 +181,12 @@ public abstract class GMSLMod
 	public void CreateObjectCodeFromFile(string path, string objName, EventType eventType, EventSubtypeDraw EventSubtype)
 	{
 		string value = "";
-		UndertaleGameObject obj = moddingData.GameObjects.ByName(objName);
+		UndertaleGameObject obj = moddingData.GameObjects.ByNameIndexed(objName);
 
 		if (scripts.TryGetValue(path, out value))
 		{
 			obj.EventHandlerFor(eventType, EventSubtype, moddingData)
-			.ReplaceGmlSafe(value, moddingData);
+			.ReplaceGmlCached(value, moddingData);
 		}
 		else
 		{
@@ -192,12 +196,12 @@ public abstract class GMSLMod
 	public void CreateObjectCodeFromFile(string path, string objName, EventType eventType, uint EventSubtype)
 	{
 		string value = "";
-		UndertaleGameObject obj = moddingData.GameObjects.ByName(objName);
+		UndertaleGameObject obj = moddingData.GameObjects.ByNameIndexed(objName);
 
 		if (scripts.TryGetValue(path, out value))
 		{
 			obj.EventHandlerFor(eventType, EventSubtype, moddingData)
-			.ReplaceGmlSafe(value, moddingData);
+			.ReplaceGmlCached(value, moddingData);
 		}
 		else
 		{
@@ -207,12 +211,12 @@ public abstract class GMSLMod
 	public void CreateObjectCodeFromFile(string path, string objName, EventType eventType, EventSubtypeKey EventSubtype)
 	{
 		string value = "";
-		UndertaleGameObject obj = moddingData.GameObjects.ByName(objName);
+		UndertaleGameObject obj = moddingData.GameObjects.ByNameIndexed(objName);
 
 		if (scripts.TryGetValue(path, out value))
 		{
 			obj.EventHandlerFor(eventType, EventSubtype, moddingData)
-			.ReplaceGmlSafe(value, moddingData);
+			.ReplaceGmlCached(value, moddingData);
 		}
 		else
 		{
@@ -223,12 +227,12 @@ public abstract class GMSLMod
 	public void CreateObjectCodeFromFile(string path, string objName, EventType eventType, EventSubtypeMouse EventSubtype)
 	{
 		string value = "";
-		UndertaleGameObject obj = moddingData.GameObjects.ByName(objName);
+		UndertaleGameObject obj = moddingData.GameObjects.ByNameIndexed(objName);
 
 		if (scripts.TryGetValue(path, out value))
 		{
 			obj.EventHandlerFor(eventType, EventSubtype, moddingData)
-			.ReplaceGmlSafe(value, moddingData);
+			.ReplaceGmlCached(value, moddingData);
 		}
 		else
 		{
@@ -240,12 +244,12 @@ public abstract class GMSLMod
 	public void CreateObjectCodeFromFile(string path, string objName, EventType eventType, EventSubtypeOther EventSubtype)
 	{
 		string value = "";
-		UndertaleGameObject obj = moddingData.GameObjects.ByName(objName);
+		UndertaleGameObject obj = moddingData.GameObjects.ByNameIndexed(objName);
 
 		if (scripts.TryGetValue(path, out value))
 		{
 			obj.EventHandlerFor(eventType, EventSubtype, moddingData)
-			.ReplaceGmlSafe(value, moddingData);
+			.ReplaceGmlCached(value, moddingData);
 		}
 		else
 		{
@@ -256,12 +260,12 @@ public abstract class GMSLMod
 	public void CreateObjectCodeFromFile(string path, string objName, EventType eventType, EventSubtypeStep EventSubtype)
 	{
 		string value = "";
-		UndertaleGameObject obj = moddingData.GameObjects.ByName(objName);
+		UndertaleGameObject obj = moddingData.GameObjects.ByNameIndexed(objName);
 
 		if (scripts.TryGetValue(path, out value))
 		{
 			obj.EventHandlerFor(eventType, EventSubtype, moddingData)
-			.ReplaceGmlSafe(value, moddingData);
+			.ReplaceGmlCached(value, moddingData);
 		}
 		else
 		{
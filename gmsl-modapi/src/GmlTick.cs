@@ -0,0 +1,13 @@
+namespace GMSL;
+
+// marks a static void method with no arguments to be run once per step by interop_tick
+[AttributeUsage(AttributeTargets.Method)]
+public class GmlTick : Attribute
+{
+    public string? Name;
+
+    public GmlTick(string? name = null)
+    {
+        Name = name;
+    }
+}
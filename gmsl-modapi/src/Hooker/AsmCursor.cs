@@ -14,6 +14,10 @@ public class AsmCursor {
         }
     }
 
+    // while batching, edits are queued against the original instruction indices and applied in Commit,
+    // so addresses and jump offsets are only resolved once instead of after every edit
+    public bool batching => _inserts is not null;
+
     private int _index;
 
     private readonly UndertaleData _data;
@@ -22,15 +26,28 @@ public class AsmCursor {
     private readonly Dictionary<string, UndertaleInstruction> _labels = new();
     private readonly Dictionary<UndertaleInstruction, string> _labelTargets = new();
 
+    private Dictionary<int, List<UndertaleInstruction>>? _inserts;
+    private Dictionary<int, UndertaleInstruction>? _replacements;
+
     public AsmCursor(UndertaleData data, UndertaleCode code, UndertaleCodeLocals locals) {
         _data = data;
         _code = code;
         _locals = locals.GetLocalVars(data);
     }
 
-    public UndertaleInstruction GetCurrent() => _code.Instructions[index];
+    public UndertaleInstruction GetCurrent() {
+        if(_replacements is not null && _replacements.TryGetValue(index, out UndertaleInstruction? replacement))
+            return replacement;
+        return _code.Instructions[index];
+    }
 
     public void Emit(UndertaleInstruction instruction) {
+        if(_inserts is not null) {
+            if(!_inserts.TryGetValue(index, out List<UndertaleInstruction>? inserts))
+                _inserts.Add(index, inserts = new List<UndertaleInstruction>());
+            inserts.Add(instruction);
+            return;
+        }
         _code.Instructions.Insert(index, instruction);
         InstructionChanged();
         index++;
@@ -39,12 +56,56 @@ public class AsmCursor {
     public void Emit(string source) => Emit(Assemble(source));
 
     public void Replace(UndertaleInstruction instruction) {
+        if(_replacements is not null) {
+            _replacements[index] = instruction;
+            return;
+        }
         _code.Instructions[index] = instruction;
         InstructionChanged();
     }
 
     public void Replace(string source) => Replace(Assemble(source));
 
+    public void BeginBatch() {
+        if(batching) return;
+        _inserts = new Dictionary<int, List<UndertaleInstruction>>();
+        _replacements = new Dictionary<int, UndertaleInstruction>();
+    }
+
+    public void Commit() {
+        if(_inserts is null || _replacements is null) return;
+        Dictionary<int, List<UndertaleInstruction>> inserts = _inserts;
+        Dictionary<int, UndertaleInstruction> replacements = _replacements;
+        _inserts = null;
+        _replacements = null;
+        if(inserts.Count == 0 && replacements.Count == 0) return;
+
+        // keep the cursor on the same original instruction, like Emit does outside of a batch
+        int newIndex = index;
+        List<UndertaleInstruction> instructions = _code.Instructions;
+        List<UndertaleInstruction> result = new(instructions.Count + inserts.Values.Sum(list => list.Count));
+        for(int i = 0; i <= instructions.Count; i++) {
+            if(inserts.TryGetValue(i, out List<UndertaleInstruction>? inserted)) {
+                result.AddRange(inserted);
+                if(i <= index) newIndex += inserted.Count;
+            }
+            if(i == instructions.Count) break;
+            result.Add(replacements.TryGetValue(i, out UndertaleInstruction? replacement) ?
+                replacement : instructions[i]);
+        }
+
+        instructions.Clear();
+        instructions.AddRange(result);
+        InstructionChanged();
+        index = newIndex;
+    }
+
+    public void Batch(Action<AsmCursor> edit) {
+        BeginBatch();
+        edit(this);
+        Commit();
+    }
+
     public void DefineLabel(string name) => _labels.Add(name, GetCurrent());
 
     public bool GotoFirst(string match) => GotoFirst(Assemble(match));
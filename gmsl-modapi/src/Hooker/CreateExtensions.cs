@@ -15,14 +15,14 @@ public static class CreateExtensions {
             Name = data.Strings.MakeString("arguments"),
             Index = 2
         });
-        data.CodeLocals.Add(locals);
+        data.CodeLocals.AddIndexed(locals);
 
         UndertaleCode mainCode = new() {
             Name = name,
             LocalsCount = 1,
             ArgumentsCount = 0
         };
-        data.Code.Add(mainCode);
+        data.Code.AddIndexed(mainCode);
 
         return mainCode;
     }
@@ -32,19 +32,19 @@ public static class CreateExtensions {
         UndertaleCode mainCode = CreateCode(data, mainName, out _);
         mainCode.ArgumentsCount = argCount;
 
-        mainCode.ReplaceGmlSafe(code, data);
+        mainCode.ReplaceGmlCached(code, data);
 
         UndertaleScript script = new() {
             Name = mainName,
             Code = mainCode
         };
-        data.Scripts.Add(script);
+        data.Scripts.AddIndexed(script);
 
         UndertaleFunction function = new() {
             Name = mainName,
             NameStringID = nameIndex
         };
-        data.Functions.Add(function);
+        data.Functions.AddIndexed(function);
 
         return script;
     }
@@ -63,13 +63,13 @@ public static class CreateExtensions {
         UndertaleCode globalCode = CreateCode(data, codeName, out locals);
         globalCode.ArgumentsCount = argCount;
 
-        globalCode.ReplaceGML(code, data);
+        globalCode.ReplaceGmlCached(code, data);
 
         UndertaleScript script = new() {
             Name = scriptName,
             Code = globalCode
         };
-        data.Scripts.Add(script);
+        data.Scripts.AddIndexed(script);
 
         data.GlobalInitScripts.Add(new UndertaleGlobalInit {
             Code = globalCode
@@ -80,15 +80,15 @@ public static class CreateExtensions {
 
     public static UndertaleScript CreateInlineFunction(this UndertaleGlobalInit parent, UndertaleData data, string name,
         string code, ushort argCount) => parent.Code.CreateInlineFunction(data, true,
-            data.CodeLocals.ByName(parent.Code.Name.Content), name, code, argCount);
+            data.CodeLocals.ByNameIndexed(parent.Code.Name.Content), name, code, argCount);
 
     public static UndertaleScript CreateInlineFunction(this UndertaleGlobalInit parent, UndertaleData data,
         UndertaleCodeLocals locals, string name, string code, ushort argCount) =>
             parent.Code.CreateInlineFunction(data, true, locals, name, code, argCount);
 
     public static UndertaleScript CreateInlineFunction(this UndertaleData data, string parent, string name,
-        string code, ushort argCount) => data.Code.ByName(parent).CreateInlineFunction(data,
-            data.CodeLocals.ByName(parent), name, code, argCount);
+        string code, ushort argCount) => data.Code.ByNameIndexed(parent).CreateInlineFunction(data,
+            data.CodeLocals.ByNameIndexed(parent), name, code, argCount);
 
     public static UndertaleScript CreateInlineFunction( this UndertaleCode parent, UndertaleData data,
         UndertaleCodeLocals parentLocals, string name, string code, ushort argCount) =>
@@ -114,7 +114,7 @@ public static class CreateExtensions {
             NameStringID = scriptNameIndex,
             Autogenerated = true
         };
-        data.Functions.Add(scriptFunction);
+        data.Functions.AddIndexed(scriptFunction);
 
         UndertaleCode scriptCode = new() {
             Name = scriptName,
@@ -123,13 +123,13 @@ public static class CreateExtensions {
             ParentEntry = parent
         };
         parent.ChildEntries.Add(scriptCode);
-        data.Code.Insert(data.Code.IndexOf(parent) + 1, scriptCode);
+        data.Code.InsertIndexed(data.Code.IndexOf(parent) + 1, scriptCode);
 
         UndertaleScript functionScript = new() {
             Name = scriptName,
             Code = scriptCode
         };
-        data.Scripts.Add(functionScript);
+        data.Scripts.AddIndexed(functionScript);
 
         return functionScript;
     }
@@ -144,7 +144,7 @@ public static class CreateExtensions {
 
         List<UndertaleInstruction> oldCode = new(code.Instructions);
         ObservableCollection<UndertaleCodeLocals.LocalVar> oldLocals = new(locals.Locals);
-        code.ReplaceGML(gmlCode, data);
+        code.ReplaceGmlCached(gmlCode, data);
         function.LocalsCount = code.LocalsCount;
         code.Replace(Assembler.Assemble(@$"
 b [func_def]
@@ -232,7 +232,7 @@ popz.v
             AudioGroup = data.AudioGroups[audioGroup],
             GroupID = audioGroup
         };
-        data.Sounds.Add(sound);
+        data.Sounds.AddIndexed(sound);
         return sound;
     }
 
@@ -0,0 +1,556 @@
+using System.Collections.Concurrent;
+using System.Collections.Specialized;
+using System.ComponentModel;
+using System.Runtime.CompilerServices;
+using System.Security.Cryptography;
+using System.Text;
+
+using UndertaleModLib;
+using UndertaleModLib.Models;
+
+namespace GMSL.Hooker;
+
+// caches compiled gml on disk so unchanged mod scripts don't go through the compiler on every rebuild
+// entries store the instructions with their strings, variables and functions by name, and are relinked on load
+public static class GmlCache {
+    private const int FormatVersion = 1;
+
+    private static string? _directory;
+    private static string _dataHash = "";
+    private static readonly string compilerVersion =
+        typeof(UndertaleData).Assembly.ManifestModule.ModuleVersionId.ToString("N");
+
+    private static readonly ConcurrentDictionary<string, string> sourceHashes = new();
+    private static readonly ConcurrentDictionary<string, CachedGml> prefetched = new();
+    private static readonly ConditionalWeakTable<IList<UndertaleVariable>, LocalIndex> localIndexes = new();
+
+    public static int hits { get; private set; }
+    public static int misses { get; private set; }
+
+    public static bool enabled => _directory is not null;
+
+    public static void Init(string directory, string dataHash) {
+        Directory.CreateDirectory(directory);
+        _directory = directory;
+        _dataHash = dataHash;
+        sourceHashes.Clear();
+        prefetched.Clear();
+        hits = 0;
+        misses = 0;
+    }
+
+    public static void Disable() => _directory = null;
+
+    // prefetched entries the mod never used (scripts it only loaded, or compiled under a different context) would
+    // otherwise stay decoded until exit
+    public static void ReleasePrefetched() => prefetched.Clear();
+
+    // reads and decodes every cached entry for the given sources across all cores, without touching the data
+    // linking still happens on the calling thread when the scripts are actually used, in the order the mod uses them
+    public static void Prefetch(IEnumerable<string> sources) {
+        if(_directory is null) return;
+        string directory = _directory;
+        Parallel.ForEach(sources.Distinct(), source => {
+            string sourceDir = Path.Combine(directory, GetSourceHash(source));
+            if(!Directory.Exists(sourceDir)) return;
+            foreach(string path in Directory.GetFiles(sourceDir, "*.bin")) {
+                try {
+                    using BinaryReader reader = new(File.OpenRead(path), Encoding.UTF8);
+                    prefetched[path] = CachedGml.Read(reader);
+                }
+                catch(Exception ex) {
+                    Logger.Logger.Warn($"Couldn't read cached gml {path}: {ex.Message}");
+                }
+            }
+        });
+    }
+
+    public static void ReplaceGmlCached(this UndertaleCode code, string gmlCode, UndertaleData data) {
+        if(_directory is null) {
+            code.ReplaceGmlSafe(gmlCode, data);
+            return;
+        }
+
+        string path = Path.Combine(_directory, GetSourceHash(gmlCode), GetContextHash(code, data) + ".bin");
+        try {
+            if(TryLoad(path, out CachedGml? cached) && cached.Link(code, data)) {
+                hits++;
+                return;
+            }
+        }
+        catch(Exception ex) {
+            Logger.Logger.Warn($"Couldn't load cached gml for {code.Name.Content}: {ex.Message}");
+        }
+
+        misses++;
+        int codeCount = data.Code.Count;
+        int functionCount = data.Functions.Count;
+        int scriptCount = data.Scripts.Count;
+        code.ReplaceGmlSafe(gmlCode, data);
+
+        // anything that defined new code entries (inline functions etc.) can't be replayed from the instructions alone
+        if(data.Code.Count != codeCount || data.Functions.Count != functionCount || data.Scripts.Count != scriptCount)
+            return;
+
+        try {
+            CachedGml? compiled = CachedGml.Capture(code, data);
+            if(compiled is not null)
+                Save(path, compiled);
+        }
+        catch(Exception ex) {
+            Logger.Logger.Warn($"Couldn't cache compiled gml for {code.Name.Content}: {ex.Message}");
+        }
+    }
+
+    private static bool TryLoad(string path, [System.Diagnostics.CodeAnalysis.NotNullWhen(true)] out CachedGml? cached) {
+        if(prefetched.TryRemove(path, out cached))
+            return true;
+        if(!File.Exists(path))
+            return false;
+        using BinaryReader reader = new(File.OpenRead(path), Encoding.UTF8);
+        cached = CachedGml.Read(reader);
+        return true;
+    }
+
+    private static void Save(string path, CachedGml compiled) {
+        Directory.CreateDirectory(Path.GetDirectoryName(path)!);
+        using MemoryStream stream = new();
+        using(BinaryWriter writer = new(stream, Encoding.UTF8, true))
+            compiled.Write(writer);
+
+        string temp = path + ".tmp";
+        File.WriteAllBytes(temp, stream.ToArray());
+        File.Move(temp, path, true);
+    }
+
+    private static string GetSourceHash(string gmlCode) => sourceHashes.GetOrAdd(gmlCode, source =>
+        Convert.ToHexString(SHA256.HashData(Encoding.UTF8.GetBytes(source))).ToLower());
+
+    // asset indices get baked into compiled code, so every name table the compiler resolves against is part of the key
+    private static string GetContextHash(UndertaleCode code, UndertaleData data) {
+        StringBuilder key = new();
+        key.Append(FormatVersion).Append('\n')
+            .Append(compilerVersion).Append('\n')
+            .Append(_dataHash).Append('\n')
+            .Append(code.Name.Content).Append('\n');
+        foreach(IEnumerable<UndertaleNamedResource>? list in AssetLists(data))
+            key.Append(list is null ? "-" : nameTables.GetValue(list, table => new NameTable(table)).Digest.ToString("x16")).Append(',');
+        return Convert.ToHexString(SHA256.HashData(Encoding.UTF8.GetBytes(key.ToString()))).ToLower();
+    }
+
+    private static IEnumerable<IEnumerable<UndertaleNamedResource>?> AssetLists(UndertaleData data) {
+        yield return data.Sprites;
+        yield return data.Sounds;
+        yield return data.Backgrounds;
+        yield return data.Paths;
+        yield return data.Scripts;
+        yield return data.Fonts;
+        yield return data.Timelines;
+        yield return data.GameObjects;
+        yield return data.Rooms;
+        yield return data.Shaders;
+        yield return data.AnimationCurves;
+        yield return data.Sequences;
+        yield return data.Functions;
+        yield return data.Code;
+    }
+
+    private static readonly ConditionalWeakTable<IEnumerable<UndertaleNamedResource>, NameTable> nameTables = new();
+
+    // digest of a list's names in order. It's kept until the list changes or one of its assets is renamed, so
+    // unchanged tables cost nothing per compile; lists that don't raise change events get rehashed every time
+    private sealed class NameTable {
+        private readonly IEnumerable<UndertaleNamedResource> _list;
+        private readonly bool _notifies;
+        private readonly HashSet<INotifyPropertyChanged> _watched = new(ReferenceEqualityComparer.Instance);
+        private ulong? _digest;
+
+        public NameTable(IEnumerable<UndertaleNamedResource> list) {
+            _list = list;
+            if(list is INotifyCollectionChanged collection) {
+                collection.CollectionChanged += (_, _) => _digest = null;
+                _notifies = true;
+            }
+        }
+
+        public ulong Digest {
+            get {
+                if(_digest is { } digest)
+                    return digest;
+
+                ulong hash = 0xcbf29ce484222325;
+                foreach(UndertaleNamedResource? asset in _list) {
+                    if(asset is INotifyPropertyChanged item && _watched.Add(item))
+                        item.PropertyChanged += OnAssetChanged;
+
+                    string name = asset?.Name?.Content ?? "";
+                    hash = (hash ^ (ulong)name.Length) * 0x100000001b3;
+                    foreach(char c in name)
+                        hash = (hash ^ c) * 0x100000001b3;
+                }
+
+                if(_notifies)
+                    _digest = hash;
+                return hash;
+            }
+        }
+
+        private void OnAssetChanged(object? sender, PropertyChangedEventArgs e) {
+            if(e.PropertyName is null or "Name")
+                _digest = null;
+        }
+    }
+
+    private enum ValueKind : byte {
+        None,
+        Int16,
+        Int32,
+        Int64,
+        Double,
+        Single,
+        Boolean,
+        String,
+        Variable,
+        Function
+    }
+
+    private sealed record CachedVariable(UndertaleInstruction.VariableType Type, string Name,
+        UndertaleInstruction.InstanceType InstanceType, int VarID) {
+        public static CachedVariable From(UndertaleInstruction.Reference<UndertaleVariable> reference) =>
+            new(reference.Type, reference.Target.Name.Content, reference.Target.InstanceType, reference.Target.VarID);
+
+        public void Write(BinaryWriter writer) {
+            writer.Write((int)Type);
+            writer.Write(Name);
+            writer.Write((short)InstanceType);
+            writer.Write(VarID);
+        }
+
+        public static CachedVariable Read(BinaryReader reader) => new(
+            (UndertaleInstruction.VariableType)reader.ReadInt32(), reader.ReadString(),
+            (UndertaleInstruction.InstanceType)reader.ReadInt16(), reader.ReadInt32());
+
+        public UndertaleInstruction.Reference<UndertaleVariable> Link(UndertaleData data) {
+            UndertaleVariable? target;
+            if(InstanceType == UndertaleInstruction.InstanceType.Local) {
+                target = FindLocal(data.Variables, Name, VarID);
+                if(target is null) {
+                    // same as what the compiler does for a local it hasn't seen before
+                    UndertaleString localName = data.Strings.MakeString(Name, out int nameIndex);
+                    target = new UndertaleVariable {
+                        Name = localName,
+                        NameStringID = nameIndex,
+                        InstanceType = InstanceType,
+                        VarID = VarID
+                    };
+                    data.Variables.Add(target);
+                }
+            }
+            else {
+                target = data.Variables.EnsureDefined(Name, InstanceType, VarID == -6, data.Strings, data);
+            }
+
+            return new UndertaleInstruction.Reference<UndertaleVariable> {
+                Target = target,
+                Type = Type
+            };
+        }
+    }
+
+    // locals by name and VarID, same first-match as a scan of the list. Variables are only ever appended, so the index
+    // remembers how far it got and a miss only looks at what was added since
+    private sealed class LocalIndex {
+        public readonly Dictionary<(string, int), UndertaleVariable> Locals = new();
+        public int Indexed;
+    }
+
+    private static UndertaleVariable? FindLocal(IList<UndertaleVariable> variables, string name, int varId) {
+        LocalIndex index = localIndexes.GetOrCreateValue(variables);
+        if(index.Locals.TryGetValue((name, varId), out UndertaleVariable? variable)) {
+            if(variable.Name?.Content == name && variable.VarID == varId &&
+               variable.InstanceType == UndertaleInstruction.InstanceType.Local)
+                return variable;
+            index.Locals.Clear();
+            index.Indexed = 0;
+        }
+
+        for(; index.Indexed < variables.Count; index.Indexed++) {
+            UndertaleVariable candidate = variables[index.Indexed];
+            if(candidate?.InstanceType == UndertaleInstruction.InstanceType.Local && candidate.Name?.Content is { } candidateName)
+                index.Locals.TryAdd((candidateName, candidate.VarID), candidate);
+        }
+        return index.Locals.GetValueOrDefault((name, varId));
+    }
+
+    private sealed record CachedFunction(UndertaleInstruction.VariableType Type, string Name) {
+        public static CachedFunction From(UndertaleInstruction.Reference<UndertaleFunction> reference) =>
+            new(reference.Type, reference.Target.Name.Content);
+
+        public void Write(BinaryWriter writer) {
+            writer.Write((int)Type);
+            writer.Write(Name);
+        }
+
+        public static CachedFunction Read(BinaryReader reader) =>
+            new((UndertaleInstruction.VariableType)reader.ReadInt32(), reader.ReadString());
+
+        public UndertaleInstruction.Reference<UndertaleFunction> Link(UndertaleData data) {
+            UndertaleFunction target = data.Functions.ByNameIndexed(Name) ??
+                throw new InvalidDataException($"Function {Name} isn't defined");
+            return new UndertaleInstruction.Reference<UndertaleFunction> {
+                Target = target,
+                Type = Type
+            };
+        }
+    }
+
+    // an instruction detached from any UndertaleData, references are kept by name until it gets linked
+    private sealed class CachedInstruction {
+        public UndertaleInstruction.Opcode Kind;
+        public UndertaleInstruction.DataType Type1;
+        public UndertaleInstruction.DataType Type2;
+        public UndertaleInstruction.InstanceType TypeInst;
+        public UndertaleInstruction.ComparisonType ComparisonKind;
+        public byte Extra;
+        public byte SwapExtra;
+        public ushort ArgumentsCount;
+        public int JumpOffset;
+        public bool JumpOffsetPopenvExitMagic;
+        public ValueKind ValueKind;
+        public object? Value;
+        public CachedVariable? Destination;
+        public CachedFunction? Function;
+
+        public static CachedInstruction? From(UndertaleInstruction instruction) {
+            CachedInstruction cached = new() {
+                Kind = instruction.Kind,
+                Type1 = instruction.Type1,
+                Type2 = instruction.Type2,
+                TypeInst = instruction.TypeInst,
+                ComparisonKind = instruction.ComparisonKind,
+                Extra = instruction.Extra,
+                SwapExtra = instruction.SwapExtra,
+                ArgumentsCount = instruction.ArgumentsCount,
+                JumpOffset = instruction.JumpOffset,
+                JumpOffsetPopenvExitMagic = instruction.JumpOffsetPopenvExitMagic,
+                Destination = instruction.Destination is null ? null : CachedVariable.From(instruction.Destination),
+                Function = instruction.Function is null ? null : CachedFunction.From(instruction.Function)
+            };
+
+            (ValueKind, object?)? value = instruction.Value switch {
+                null => (ValueKind.None, null),
+                short int16 => (ValueKind.Int16, int16),
+                int int32 => (ValueKind.Int32, int32),
+                long int64 => (ValueKind.Int64, int64),
+                double real => (ValueKind.Double, real),
+                float single => (ValueKind.Single, single),
+                bool boolean => (ValueKind.Boolean, boolean),
+                UndertaleResourceById<UndertaleString, UndertaleChunkSTRG> str => (ValueKind.String, str.Resource.Content),
+                UndertaleInstruction.Reference<UndertaleVariable> variable =>
+                    (ValueKind.Variable, CachedVariable.From(variable)),
+                UndertaleInstruction.Reference<UndertaleFunction> function =>
+                    (ValueKind.Function, CachedFunction.From(function)),
+                _ => null
+            };
+            if(value is null)
+                return null;
+
+            (cached.ValueKind, cached.Value) = value.Value;
+            return cached;
+        }
+
+        public void Write(BinaryWriter writer) {
+            writer.Write((byte)Kind);
+            writer.Write((byte)Type1);
+            writer.Write((byte)Type2);
+            writer.Write((short)TypeInst);
+            writer.Write((byte)ComparisonKind);
+            writer.Write(Extra);
+            writer.Write(SwapExtra);
+            writer.Write(ArgumentsCount);
+            writer.Write(JumpOffset);
+            writer.Write(JumpOffsetPopenvExitMagic);
+
+            writer.Write((byte)ValueKind);
+            switch(Value) {
+                case short value: writer.Write(value); break;
+                case int value: writer.Write(value); break;
+                case long value: writer.Write(value); break;
+                case double value: writer.Write(value); break;
+                case float value: writer.Write(value); break;
+                case bool value: writer.Write(value); break;
+                case string value: writer.Write(value); break;
+                case CachedVariable value: value.Write(writer); break;
+                case CachedFunction value: value.Write(writer); break;
+            }
+
+            writer.Write(Destination is not null);
+            Destination?.Write(writer);
+            writer.Write(Function is not null);
+            Function?.Write(writer);
+        }
+
+        public static CachedInstruction Read(BinaryReader reader) {
+            CachedInstruction cached = new() {
+                Kind = (UndertaleInstruction.Opcode)reader.ReadByte(),
+                Type1 = (UndertaleInstruction.DataType)reader.ReadByte(),
+                Type2 = (UndertaleInstruction.DataType)reader.ReadByte(),
+                TypeInst = (UndertaleInstruction.InstanceType)reader.ReadInt16(),
+                ComparisonKind = (UndertaleInstruction.ComparisonType)reader.ReadByte(),
+                Extra = reader.ReadByte(),
+                SwapExtra = reader.ReadByte(),
+                ArgumentsCount = reader.ReadUInt16(),
+                JumpOffset = reader.ReadInt32(),
+                JumpOffsetPopenvExitMagic = reader.ReadBoolean(),
+                ValueKind = (ValueKind)reader.ReadByte()
+            };
+
+            cached.Value = cached.ValueKind switch {
+                ValueKind.None => null,
+                ValueKind.Int16 => reader.ReadInt16(),
+                ValueKind.Int32 => reader.ReadInt32(),
+                ValueKind.Int64 => reader.ReadInt64(),
+                ValueKind.Double => reader.ReadDouble(),
+                ValueKind.Single => reader.ReadSingle(),
+                ValueKind.Boolean => reader.ReadBoolean(),
+                ValueKind.String => reader.ReadString(),
+                ValueKind.Variable => CachedVariable.Read(reader),
+                ValueKind.Function => CachedFunction.Read(reader),
+                _ => throw new InvalidDataException($"Unknown value kind {cached.ValueKind}")
+            };
+
+            if(reader.ReadBoolean())
+                cached.Destination = CachedVariable.Read(reader);
+            if(reader.ReadBoolean())
+                cached.Function = CachedFunction.Read(reader);
+
+            return cached;
+        }
+
+        // functions are the only references that can be missing, this checks them without touching the data
+        public bool CanLink(UndertaleData data) =>
+            (Value is not CachedFunction value || data.Functions.ByNameIndexed(value.Name) is not null) &&
+            (Function is null || data.Functions.ByNameIndexed(Function.Name) is not null);
+
+        public UndertaleInstruction Link(UndertaleData data) {
+            UndertaleInstruction instruction = new() {
+                Kind = Kind,
+                Type1 = Type1,
+                Type2 = Type2,
+                TypeInst = TypeInst,
+                ComparisonKind = ComparisonKind,
+                Extra = Extra,
+                SwapExtra = SwapExtra,
+                ArgumentsCount = ArgumentsCount,
+                JumpOffset = JumpOffset,
+                JumpOffsetPopenvExitMagic = JumpOffsetPopenvExitMagic
+            };
+
+            switch(Value) {
+                case string value:
+                    UndertaleString str = data.Strings.MakeString(value, out int strIndex);
+                    instruction.Value = new UndertaleResourceById<UndertaleString, UndertaleChunkSTRG> {
+                        Resource = str,
+                        CachedId = strIndex
+                    };
+                    break;
+                case CachedVariable value:
+                    instruction.Value = value.Link(data);
+                    break;
+                case CachedFunction value:
+                    instruction.Value = value.Link(data);
+                    break;
+                default:
+                    instruction.Value = Value;
+                    break;
+            }
+
+            if(Destination is not null)
+                instruction.Destination = Destination.Link(data);
+            if(Function is not null)
+                instruction.Function = Function.Link(data);
+
+            return instruction;
+        }
+    }
+
+    private sealed class CachedGml {
+        public uint LocalsCount;
+        public List<(string, uint)>? Locals;
+        public List<CachedInstruction> Instructions = new();
+
+        public static CachedGml? Capture(UndertaleCode code, UndertaleData data) {
+            CachedGml cached = new() {
+                LocalsCount = code.LocalsCount,
+                Locals = data.CodeLocals?.ByNameIndexed(code.Name.Content)?.Locals
+                    .Select(local => (local.Name.Content, local.Index)).ToList()
+            };
+            foreach(UndertaleInstruction instruction in code.Instructions) {
+                CachedInstruction? cachedInstruction = CachedInstruction.From(instruction);
+                if(cachedInstruction is null)
+                    return null;
+                cached.Instructions.Add(cachedInstruction);
+            }
+            return cached;
+        }
+
+        public void Write(BinaryWriter writer) {
+            writer.Write(LocalsCount);
+            writer.Write(Locals?.Count ?? -1);
+            if(Locals is not null)
+                foreach((string name, uint index) in Locals) {
+                    writer.Write(name);
+                    writer.Write(index);
+                }
+
+            writer.Write(Instructions.Count);
+            foreach(CachedInstruction instruction in Instructions)
+                instruction.Write(writer);
+        }
+
+        public static CachedGml Read(BinaryReader reader) {
+            CachedGml cached = new() {
+                LocalsCount = reader.ReadUInt32()
+            };
+
+            int localCount = reader.ReadInt32();
+            if(localCount >= 0) {
+                cached.Locals = new List<(string, uint)>(localCount);
+                for(int i = 0; i < localCount; i++)
+                    cached.Locals.Add((reader.ReadString(), reader.ReadUInt32()));
+            }
+
+            int instructionCount = reader.ReadInt32();
+            cached.Instructions = new List<CachedInstruction>(instructionCount);
+            for(int i = 0; i < instructionCount; i++)
+                cached.Instructions.Add(CachedInstruction.Read(reader));
+
+            return cached;
+        }
+
+        // linking adds strings and variables to the data, so a miss has to be known before the first one is added
+        public bool Link(UndertaleCode code, UndertaleData data) {
+            if(!Instructions.All(instruction => instruction.CanLink(data)))
+                return false;
+
+            List<UndertaleInstruction> instructions = new(Instructions.Count);
+            foreach(CachedInstruction cachedInstruction in Instructions)
+                instructions.Add(cachedInstruction.Link(data));
+
+            code.Replace(instructions);
+            code.LocalsCount = LocalsCount;
+
+            UndertaleCodeLocals? locals = data.CodeLocals?.ByNameIndexed(code.Name.Content);
+            if(locals is not null && Locals is not null) {
+                locals.Locals.Clear();
+                foreach((string name, uint index) in Locals)
+                    locals.Locals.Add(new UndertaleCodeLocals.LocalVar {
+                        Name = data.Strings.MakeString(name),
+                        Index = index
+                    });
+            }
+
+            return true;
+        }
+    }
+}
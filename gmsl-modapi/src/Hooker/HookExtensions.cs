@@ -17,8 +17,8 @@ public static class HookExtensions {
             WeirdLocalFlag = cloning.WeirdLocalFlag
         };
         codeClone.Replace(cloning.Instructions);
-        data.Code.Insert(data.Code.IndexOf(cloning) + 1, codeClone);
-        data.Scripts.Add(new UndertaleScript {
+        data.Code.InsertIndexed(data.Code.IndexOf(cloning) + 1, codeClone);
+        data.Scripts.AddIndexed(new UndertaleScript {
             Name = codeClone.Name,
             Code = codeClone
         });
@@ -41,22 +41,22 @@ public static class HookExtensions {
                 Index = localVar.Index
             });
         cloningLocals.Locals.Clear();
-        data.CodeLocals.Add(localsClone);
+        data.CodeLocals.AddIndexed(localsClone);
 
         return codeClone;
     }
 
     public static void HookCode(this UndertaleData data, string code, string hook) =>
-        data.Code.ByName(code).Hook(data, data.CodeLocals.ByName(code), hook);
+        data.Code.ByNameIndexed(code).Hook(data, data.CodeLocals.ByNameIndexed(code), hook);
 
     public static void Hook(this UndertaleCode code, UndertaleData data, UndertaleCodeLocals locals, string hook) {
         string originalName = GetDerivativeName(code.Name.Content, "orig");
         originalCodes.TryAdd(code.Name.Content, MoveCodeForHook(data, originalName, code, locals));
-        code.ReplaceGmlSafe(hook.Replace("#orig#", $"{originalName}"), data);
+        code.ReplaceGmlCached(hook.Replace("#orig#", $"{originalName}"), data);
     }
 
     public static void HookFunction(this UndertaleData data, string function, string hook) {
-        ushort argCount = data.Code.ByName("gml_Script_" + function).ArgumentsCount;
+        ushort argCount = data.Code.ByNameIndexed("gml_Script_" + function).ArgumentsCount;
         HardHook(data, function, hook, argCount);
     }
 
@@ -64,8 +64,8 @@ public static class HookExtensions {
 
     public static void HookAsm(this UndertaleData data, string name, AsmHook hook) {
         if(!originalCodes.TryGetValue(name, out UndertaleCode? code))
-            code = data.Code.ByName(name);
-        code.Hook(data.CodeLocals.ByName(code.Name.Content), hook);
+            code = data.Code.ByNameIndexed(name);
+        code.Hook(data.CodeLocals.ByNameIndexed(code.Name.Content), hook);
     }
 
     public static void Hook(this UndertaleCode code, UndertaleCodeLocals locals, AsmHook hook) {
@@ -73,6 +73,21 @@ public static class HookExtensions {
         code.UpdateAddresses();
     }
 
+    public delegate void AsmCursorHook(AsmCursor cursor);
+
+    // edits made through the cursor are batched and committed once after the hook returns
+    public static void HookAsm(this UndertaleData data, string name, AsmCursorHook hook) {
+        if(!originalCodes.TryGetValue(name, out UndertaleCode? code))
+            code = data.Code.ByNameIndexed(name);
+        code.Hook(data, data.CodeLocals.ByNameIndexed(code.Name.Content), hook);
+    }
+
+    public static void Hook(this UndertaleCode code, UndertaleData data, UndertaleCodeLocals locals,
+        AsmCursorHook hook) {
+        AsmCursor cursor = new(data, code, locals);
+        cursor.Batch(batch => hook(batch));
+    }
+
     public static void HardHook(this UndertaleData data, string function, string hook, ushort argCount) {
         function = "gml_Script_" + function;
         string hookName = GetDerivativeName(function, "hook");
@@ -81,24 +96,22 @@ public static class HookExtensions {
     }
 
     public static void FinalizeHooks(this UndertaleData data){
+        if(hooksToWrite.Count == 0) return;
         foreach(UndertaleCode code in data.Code) {
             if(code.ParentEntry is not null) continue;
-            code.Hook(data.CodeLocals.ByName(code.Name.Content), (origCode, locals) => {
-                if (origCode.Name.Content.StartsWith("gmml_")) {
-                    Logger.Logger.Info("skipping hook rewrite for " + origCode.Name.Content);
-                    return;
-                }
-                foreach(string function in hooksToWrite.Keys) {
-                    var newHookInfo = hooksToWrite[function];
-                    string hookName = newHookInfo.Item1;
-                    ushort argCount = newHookInfo.Item2;
-                    AsmCursor cursor = new(data, origCode, locals);
+            if(code.Name.Content.StartsWith("gmml_")) {
+                Logger.Logger.Info("skipping hook rewrite for " + code.Name.Content);
+                continue;
+            }
+            code.Hook(data, data.CodeLocals.ByNameIndexed(code.Name.Content), cursor => {
+                foreach((string function, (string hookName, ushort argCount)) in hooksToWrite) {
+                    cursor.index = 0;
                     while(cursor.GotoNext($"call.i {function}(argc={argCount})")){
                         cursor.Replace($"call.i {hookName}(argc={argCount})");
                     }
-                    AsmCursor cursor2 = new(data, origCode, locals);
-                    while(cursor2.GotoNext($"push.i {function}")){
-                        cursor2.Replace($"push.i {hookName}");
+                    cursor.index = 0;
+                    while(cursor.GotoNext($"push.i {function}")){
+                        cursor.Replace($"push.i {hookName}");
                     }
                 }
             });
@@ -112,6 +125,12 @@ public static class HookExtensions {
         UndertaleData data) => locals.Locals.ToDictionary(local => local.Name.Content, local =>
         data.Variables.First(variable => variable.VarID == (int)local.Index));
 
-    private static string GetDerivativeName(string name, string suffix) =>
-        $"gmml_{name}_{suffix}_{Guid.NewGuid().ToString().Replace('-', '_')}";
+    // deterministic across runs so the hook sources (and their GmlCache keys) stay the same between rebuilds
+    private static readonly Dictionary<string, int> derivativeCounts = new();
+    private static string GetDerivativeName(string name, string suffix) {
+        string baseName = $"gmml_{name}_{suffix}";
+        derivativeCounts.TryGetValue(baseName, out int count);
+        derivativeCounts[baseName] = count + 1;
+        return $"{baseName}_{count}";
+    }
 }
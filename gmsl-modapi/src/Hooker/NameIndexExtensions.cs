@@ -0,0 +1,82 @@
+using System.Runtime.CompilerServices;
+
+using UndertaleModLib;
+
+namespace GMSL.Hooker;
+
+// name -> asset lookups for the data's asset lists, built on first use and kept in sync by AddIndexed/InsertIndexed.
+// Nothing removes assets from the lists, so the index remembers how many entries it has seen and a miss only indexes
+// what was appended behind our back since. Misses are common (GMS 2.3 child code entries have no CodeLocals of their
+// own), so they don't fall back to a ByName scan. An asset renamed after it was indexed is found under its new name
+// once a lookup of its old one notices and rebuilds the index.
+public static class NameIndexExtensions {
+    private class Index<T> where T : class, UndertaleNamedResource {
+        public readonly Dictionary<string, T> Assets;
+        public int Indexed;
+
+        public Index(int capacity) {
+            Assets = new Dictionary<string, T>(capacity);
+        }
+    }
+
+    private static class NameIndex<T> where T : class, UndertaleNamedResource {
+        public static readonly ConditionalWeakTable<IList<T>, Index<T>> tables = new();
+    }
+
+    public static T? ByNameIndexed<T>(this IList<T> list, string name) where T : class, UndertaleNamedResource {
+        Index<T> index = NameIndex<T>.tables.GetValue(list, BuildIndex);
+        if(index.Assets.TryGetValue(name, out T? asset)) {
+            if(asset.Name?.Content == name)
+                return asset;
+
+            // renamed since it was indexed, the old name can't be trusted for anything else either
+            index = Rebuild(list);
+            return index.Assets.GetValueOrDefault(name);
+        }
+
+        if(list.Count <= index.Indexed)
+            return null;
+        IndexAppended(list, index);
+        return index.Assets.GetValueOrDefault(name);
+    }
+
+    public static void AddIndexed<T>(this IList<T> list, T asset) where T : class, UndertaleNamedResource {
+        list.Add(asset);
+        if(NameIndex<T>.tables.TryGetValue(list, out Index<T>? index))
+            IndexAppended(list, index);
+    }
+
+    public static void InsertIndexed<T>(this IList<T> list, int position, T asset)
+        where T : class, UndertaleNamedResource {
+        list.Insert(position, asset);
+        if(!NameIndex<T>.tables.TryGetValue(list, out Index<T>? index))
+            return;
+
+        // inside the indexed part the entries after it only shift, past it the next IndexAppended picks it up
+        if(position < index.Indexed) {
+            if(asset.Name?.Content is { } name)
+                index.Assets.TryAdd(name, asset);
+            index.Indexed++;
+        }
+    }
+
+    // first entry wins, same as ByName
+    private static void IndexAppended<T>(IList<T> list, Index<T> index) where T : class, UndertaleNamedResource {
+        for(int i = index.Indexed; i < list.Count; i++)
+            if(list[i]?.Name?.Content is { } name)
+                index.Assets.TryAdd(name, list[i]);
+        index.Indexed = list.Count;
+    }
+
+    private static Index<T> BuildIndex<T>(IList<T> list) where T : class, UndertaleNamedResource {
+        Index<T> index = new(list.Count);
+        IndexAppended(list, index);
+        return index;
+    }
+
+    private static Index<T> Rebuild<T>(IList<T> list) where T : class, UndertaleNamedResource {
+        Index<T> index = BuildIndex(list);
+        NameIndex<T>.tables.AddOrUpdate(list, index);
+        return index;
+    }
+}
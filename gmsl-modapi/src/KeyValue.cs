@@ -0,0 +1,75 @@
+using System.Runtime.CompilerServices;
+
+namespace GMSL;
+
+// the native key-value store in gmsl-interop, shared with GML through the interop_kv_* functions.
+// Keys are interned natively, cache the handle from Key() for anything read every frame.
+public static class KeyValue
+{
+    public static IntPtr Key(string name)
+    {
+        return KeyNative(name);
+    }
+
+    public static bool TryGetDouble(IntPtr key, out double value)
+    {
+        return TryGetDoubleNative(key, out value);
+    }
+
+    public static bool TryGetLong(IntPtr key, out long value)
+    {
+        return TryGetLongNative(key, out value);
+    }
+
+    public static double GetDouble(IntPtr key, double fallback = 0)
+    {
+        return TryGetDoubleNative(key, out double value) ? value : fallback;
+    }
+
+    public static long GetLong(IntPtr key, long fallback = 0)
+    {
+        return TryGetLongNative(key, out long value) ? value : fallback;
+    }
+
+    public static string? GetString(IntPtr key)
+    {
+        return GetStringNative(key);
+    }
+
+    public static void Set(IntPtr key, double value) => SetDoubleNative(key, value);
+    public static void Set(IntPtr key, long value) => SetLongNative(key, value);
+    public static void Set(IntPtr key, string? value) => SetStringNative(key, value);
+    public static void Remove(IntPtr key) => RemoveNative(key);
+
+    public static double GetDouble(string key, double fallback = 0) => GetDouble(Key(key), fallback);
+    public static long GetLong(string key, long fallback = 0) => GetLong(Key(key), fallback);
+    public static string? GetString(string key) => GetString(Key(key));
+    public static void Set(string key, double value) => Set(Key(key), value);
+    public static void Set(string key, long value) => Set(Key(key), value);
+    public static void Set(string key, string? value) => Set(Key(key), value);
+    public static void Remove(string key) => Remove(Key(key));
+
+    [MethodImpl(MethodImplOptions.InternalCall)]
+    private static extern IntPtr KeyNative(string name);
+
+    [MethodImpl(MethodImplOptions.InternalCall)]
+    private static extern bool TryGetDoubleNative(IntPtr key, out double value);
+
+    [MethodImpl(MethodImplOptions.InternalCall)]
+    private static extern bool TryGetLongNative(IntPtr key, out long value);
+
+    [MethodImpl(MethodImplOptions.InternalCall)]
+    private static extern string? GetStringNative(IntPtr key);
+
+    [MethodImpl(MethodImplOptions.InternalCall)]
+    private static extern void SetDoubleNative(IntPtr key, double value);
+
+    [MethodImpl(MethodImplOptions.InternalCall)]
+    private static extern void SetLongNative(IntPtr key, long value);
+
+    [MethodImpl(MethodImplOptions.InternalCall)]
+    private static extern void SetStringNative(IntPtr key, string? value);
+
+    [MethodImpl(MethodImplOptions.InternalCall)]
+    private static extern void RemoveNative(IntPtr key);
+}
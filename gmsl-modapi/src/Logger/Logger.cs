@@ -1,30 +1,61 @@
+using System.Runtime.CompilerServices;
+
 namespace GMSL.Logger;
 
 public static class Logger
 {
+    // inside the game the interop runtime is mono and owns the log thread, the patcher runs on .NET and has no backend
+    private static readonly bool native = Type.GetType("Mono.Runtime") != null;
+    private static readonly object consoleLock = new();
+    private static LogLevel? consoleLevel;
 
     private static void Log(object message, LogLevel level)
     {
-        switch (level)
+        if (native)
         {
-            case LogLevel.Info:
-                Console.ForegroundColor = ConsoleColor.White;
-                Console.WriteLine($"  [INFO] {message}");
-                break;
-            
-            case LogLevel.Warning:
-                Console.ForegroundColor = ConsoleColor.Yellow;
-                Console.WriteLine($"[WARNING] {message}");
-                break;
-            
-            case LogLevel.Error:
-                Console.ForegroundColor = ConsoleColor.Red;
-                Console.WriteLine($"  [ERROR] {message}");
-                break;
+            LogNative(message, level);
+            return;
+        }
+
+        lock (consoleLock)
+        {
+            // only touch the console color when the level actually changes
+            if (consoleLevel != level)
+            {
+                Console.ForegroundColor = level switch
+                {
+                    LogLevel.Warning => ConsoleColor.Yellow,
+                    LogLevel.Error => ConsoleColor.Red,
+                    _ => ConsoleColor.White
+                };
+                consoleLevel = level;
+            }
+
+            switch (level)
+            {
+                case LogLevel.Info:
+                    Console.WriteLine($"  [INFO] {message}");
+                    break;
+
+                case LogLevel.Warning:
+                    Console.WriteLine($"[WARNING] {message}");
+                    break;
+
+                case LogLevel.Error:
+                    Console.WriteLine($"  [ERROR] {message}");
+                    break;
+            }
         }
     }
 
     public static void Info(object message) => Log(message, LogLevel.Info);
     public static void Warn(object message) => Log(message, LogLevel.Warning);
     public static void Error(object message) => Log(message, LogLevel.Error);
-}
\ No newline at end of file
+
+    // kept out of Log, .NET refuses to compile any method that references an internal call outside corelib
+    [MethodImpl(MethodImplOptions.NoInlining)]
+    private static void LogNative(object message, LogLevel level) => WriteNative((int)level, message?.ToString() ?? "null");
+
+    [MethodImpl(MethodImplOptions.InternalCall)]
+    private static extern void WriteNative(int level, string message);
+}
@@ -0,0 +1,17 @@
+using System.Collections;
+using System.Runtime.CompilerServices;
+
+namespace GMSL;
+
+// long running game thread work, split into slices by yielding, gets resumed every step by gmsl-interop
+// until the per frame budget runs out. Yield a float or double between 0 and 1 to report progress.
+public static class Scheduler
+{
+    public static int Start(IEnumerator job, int priority = 1, string? name = null)
+    {
+        return StartNative(job, priority, name ?? job.GetType().Name);
+    }
+
+    [MethodImpl(MethodImplOptions.InternalCall)]
+    private static extern int StartNative(IEnumerator job, int priority, string name);
+}
@@ -0,0 +1,33 @@
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+
+namespace GMSL;
+
+// runtime registration for per-step callbacks, these get run by gmsl-interop's interop_tick alongside [GmlTick] methods
+public static class Tick
+{
+    public delegate void Update();
+
+    // the native side only holds a function pointer, so the delegates have to be kept alive here
+    private static readonly List<Update> _callbacks = new();
+
+    public static void Register(string name, Update update)
+    {
+        Update guarded = () =>
+        {
+            try
+            {
+                update();
+            }
+            catch (Exception ex)
+            {
+                Logger.Logger.Error($"Tick callback {name} threw: {ex}");
+            }
+        };
+        _callbacks.Add(guarded);
+        RegisterNative(name, Marshal.GetFunctionPointerForDelegate(guarded));
+    }
+
+    [MethodImpl(MethodImplOptions.InternalCall)]
+    private static extern void RegisterNative(string name, IntPtr callback);
+}
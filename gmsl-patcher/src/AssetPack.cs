@@ -0,0 +1,150 @@
+using System.Text;
+using GMSL.Logger;
+
+namespace gmsl_patcher;
+
+// <mod>.pack, every file under a mod's assets directory packed into one file that gmsl-interop maps once at startup
+// and serves to GML by path (see assets.cpp). The header carries a fingerprint of the directory listing, so a pack
+// is only rewritten when a file was added, removed, resized or touched.
+// Layout, little endian:
+//   u32 magic "GMAP", u32 version, u32 entry count, u32 reserved, u64 fingerprint
+//   per entry, sorted by hash: u64 path hash, u64 data offset, u32 size, u32 name offset
+//   names: utf8, relative to the assets directory, '/' separated, null terminated
+//   data: every file starts 16 byte aligned
+public static class AssetPack
+{
+	private const uint Magic = 0x50414d47;
+	private const uint Version = 1;
+	private const int HeaderSize = 24;
+	private const int EntrySize = 24;
+	private const int Alignment = 16;
+
+	// returns true when the pack was (re)written
+	public static bool Build(string assetsDir, string packPath)
+	{
+		if (!Directory.Exists(assetsDir))
+		{
+			if (File.Exists(packPath)) File.Delete(packPath);
+			return false;
+		}
+
+		var files = Directory.GetFiles(assetsDir, "*", SearchOption.AllDirectories)
+			.Select(path => new FileInfo(path))
+			.Select(info => (Info: info, Name: Path.GetRelativePath(assetsDir, info.FullName).Replace('\\', '/')))
+			.OrderBy(file => file.Name, StringComparer.Ordinal)
+			.ToList();
+
+		// interop_asset_load hands sizes to the runner as ints
+		foreach (var file in files.Where(file => file.Info.Length > int.MaxValue))
+		{
+			Logger.Warn($"Asset {file.Name} is over 2GB, GML buffers can't hold it so it isn't packed");
+		}
+		files.RemoveAll(file => file.Info.Length > int.MaxValue);
+
+		var fingerprint = Fingerprint(files.Select(file => (file.Name, file.Info.Length, file.Info.LastWriteTimeUtc.Ticks)));
+		if (ReadFingerprint(packPath) == fingerprint) return false;
+
+		var entries = files
+			.Select(file => (file.Info, Name: Encoding.UTF8.GetBytes(file.Name), Hash: Hash(file.Name)))
+			.OrderBy(entry => entry.Hash)
+			.ToList();
+
+		var names = new List<uint>();
+		long offset = HeaderSize + (long)EntrySize * entries.Count;
+		foreach (var entry in entries)
+		{
+			names.Add((uint)offset);
+			offset += entry.Name.Length + 1;
+		}
+
+		var offsets = new List<long>();
+		foreach (var entry in entries)
+		{
+			offset = Align(offset);
+			offsets.Add(offset);
+			offset += entry.Info.Length;
+		}
+
+		Directory.CreateDirectory(Path.GetDirectoryName(packPath)!);
+		var tmp = packPath + ".tmp";
+		using (var stream = File.Create(tmp))
+		using (var writer = new BinaryWriter(stream))
+		{
+			writer.Write(Magic);
+			writer.Write(Version);
+			writer.Write((uint)entries.Count);
+			writer.Write(0u);
+			writer.Write(fingerprint);
+
+			for (int i = 0; i < entries.Count; i++)
+			{
+				writer.Write(entries[i].Hash);
+				writer.Write((ulong)offsets[i]);
+				writer.Write((uint)entries[i].Info.Length);
+				writer.Write(names[i]);
+			}
+
+			foreach (var entry in entries)
+			{
+				writer.Write(entry.Name);
+				writer.Write((byte)0);
+			}
+
+			for (int i = 0; i < entries.Count; i++)
+			{
+				writer.Flush();
+				stream.SetLength(offsets[i]);
+				stream.Position = offsets[i];
+				using var file = File.OpenRead(entries[i].Info.FullName);
+				file.CopyTo(stream);
+			}
+		}
+		File.Move(tmp, packPath, true);
+
+		Logger.Info($"Packed {entries.Count} assets into {packPath} ({offset} bytes)");
+		return true;
+	}
+
+	private static long Align(long offset) => (offset + Alignment - 1) & ~(long)(Alignment - 1);
+
+	// fnv-1a over the utf8 path with ascii folded to lower case and '\' as '/', assets.cpp hashes the same way
+	private static ulong Hash(string name)
+	{
+		var hash = 0xcbf29ce484222325ul;
+		foreach (var b in Encoding.UTF8.GetBytes(name))
+		{
+			var c = b == '\\' ? (byte)'/' : b;
+			if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+			hash = (hash ^ c) * 0x100000001b3ul;
+		}
+		return hash;
+	}
+
+	private static ulong Fingerprint(IEnumerable<(string Name, long Size, long Time)> files)
+	{
+		var hash = 0xcbf29ce484222325ul ^ Version;
+		foreach (var file in files)
+		{
+			foreach (var b in Encoding.UTF8.GetBytes($"{file.Name}\0{file.Size}\0{file.Time}\0"))
+			{
+				hash = (hash ^ b) * 0x100000001b3ul;
+			}
+		}
+		return hash;
+	}
+
+	private static ulong? ReadFingerprint(string packPath)
+	{
+		try
+		{
+			using var reader = new BinaryReader(File.OpenRead(packPath));
+			if (reader.ReadUInt32() != Magic || reader.ReadUInt32() != Version) return null;
+			reader.ReadUInt64();
+			return reader.ReadUInt64();
+		}
+		catch (IOException)
+		{
+			return null;
+		}
+	}
+}
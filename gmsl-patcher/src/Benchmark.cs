@@ -0,0 +1,273 @@
+using System.Diagnostics;
+using System.Reflection;
+using GMSL;
+using GMSL.Hooker;
+using GMSL.Logger;
+using UndertaleModLib;
+using UndertaleModLib.Models;
+
+namespace gmsl_patcher;
+
+// Headless runs of the patch pipeline, so rebuild times can be measured on any OS without a game install.
+//   gmsl-patcher --synthesize <out.win> [--functions n] [--objects n] [--rooms n] [--instances n] [--strings n]
+//                [--textures n] [--texture-size n] [--seed n]
+//   gmsl-patcher --benchmark <data.win> [--mods dir] [--synthetic-mods n] [--hooks n] [--out path]
+//                [--texture-cache dir] [--gml-cache dir] [--csv path]
+// A benchmark goes through the same stages as a rebuild in Main (load, BuildLoadOrder, PrepareMod / Patch /
+// FinalizeMod per mod, UndertaleIO.Write) and reports wall time, allocations, live heap and peak memory per stage.
+// Caches default to a scratch directory that's deleted afterwards, so every run is cold unless --texture-cache or
+// --gml-cache point somewhere persistent. The hooker keeps static state across mods, that's part of what gets
+// measured, so it's one benchmark per process.
+public static class Benchmark
+{
+	private class Stage
+	{
+		public string Name = "";
+		public TimeSpan Wall;
+		public long Allocated;
+		public long Heap;
+		public long Peak;
+	}
+
+	public static void Synthesize(string[] args)
+	{
+		var options = ParseOptions(args, out var outPath);
+		if (outPath == null)
+		{
+			Logger.Error("usage: gmsl-patcher --synthesize <out.win> [--functions n] [--objects n] [--rooms n] [--instances n] [--strings n] [--textures n] [--texture-size n] [--seed n]");
+			return;
+		}
+
+		var synthetic = new SyntheticOptions();
+		synthetic.Functions = Int(options, "functions", synthetic.Functions);
+		synthetic.Objects = Int(options, "objects", synthetic.Objects);
+		synthetic.Rooms = Int(options, "rooms", synthetic.Rooms);
+		synthetic.Instances = Int(options, "instances", synthetic.Instances);
+		synthetic.Strings = Int(options, "strings", synthetic.Strings);
+		synthetic.TexturePages = Int(options, "textures", synthetic.TexturePages);
+		synthetic.TextureSize = Int(options, "texture-size", synthetic.TextureSize);
+		synthetic.Seed = Int(options, "seed", synthetic.Seed);
+
+		var watch = Stopwatch.StartNew();
+		var data = SyntheticData.Generate(synthetic);
+
+		Logger.Info($"Writing {outPath}...");
+		Directory.CreateDirectory(Path.GetDirectoryName(Path.GetFullPath(outPath))!);
+		using (var stream = File.Create(outPath))
+		{
+			UndertaleIO.Write(stream, data, msg =>
+			{
+				Logger.Info($"[UMT]: {msg}");
+			});
+		}
+
+		Logger.Info($"Generated {data.Code.Count} code entries, {data.GameObjects.Count} objects, {data.Rooms.Count} rooms, {data.Strings.Count} strings and {data.EmbeddedTextures.Count} texture pages ({new FileInfo(outPath).Length / 1048576.0:0.0} MB) in {watch.Elapsed.TotalSeconds:0.00}s");
+	}
+
+	public static void Run(string[] args)
+	{
+		var options = ParseOptions(args, out var dataPath);
+		if (dataPath == null)
+		{
+			Logger.Error("usage: gmsl-patcher --benchmark <data.win> [--mods dir] [--synthetic-mods n] [--hooks n] [--out path] [--texture-cache dir] [--gml-cache dir] [--csv path]");
+			return;
+		}
+
+		var scratch = Path.Combine(Path.GetTempPath(), $"gmsl-benchmark-{Environment.ProcessId}");
+		var outPath = options.GetValueOrDefault("out") ?? Path.Combine(scratch, "cache.win");
+		var textureCacheDir = options.GetValueOrDefault("texture-cache") ?? Path.Combine(scratch, "textures");
+		var modsDir = options.GetValueOrDefault("mods");
+		var syntheticMods = Int(options, "synthetic-mods", modsDir == null ? 4 : 0);
+		var hooks = Int(options, "hooks", 50);
+
+		var mods = new List<ModInfo>();
+		if (modsDir != null)
+		{
+			foreach (var mod in Program.LoadModInfos(Directory.GetDirectories(modsDir)))
+			{
+				var modPath = Path.Combine(mod.ModDir, mod.Name + ".dll");
+				if (!File.Exists(modPath))
+				{
+					Logger.Error($"Error loading mod {mod.ID} cant find {modPath}");
+					continue;
+				}
+
+				mod.Assembly = Assembly.LoadFrom(modPath);
+				var type = mod.Assembly.GetTypes().FirstOrDefault(Program.IsModType);
+				if (type == null)
+				{
+					Logger.Error($"Mod {mod.ID} has no mod class");
+					continue;
+				}
+				mod.Instance = (GMSLMod)Activator.CreateInstance(type)!;
+				mods.Add(mod);
+			}
+		}
+
+		// chained dependencies so BuildLoadOrder has something to resolve
+		for (int i = 0; i < syntheticMods; i++)
+		{
+			mods.Add(new ModInfo
+			{
+				Name = $"synthetic{i}",
+				ID = $"synthetic{i}",
+				Version = "1.0.0",
+				Description = "",
+				Dependencies = i > 0 ? new List<string> { $"synthetic{i - 1}" } : new List<string>(),
+				ModDir = Path.Combine(scratch, "mods", $"synthetic{i}"),
+				Instance = new SyntheticMod(i, syntheticMods, hooks)
+			});
+		}
+
+		var stream = File.OpenRead(dataPath);
+		var dataHash = Program.HashFile(stream);
+		stream.Position = 0;
+
+		if (options.TryGetValue("gml-cache", out var gmlCacheDir))
+			GmlCache.Init(gmlCacheDir, dataHash);
+		else
+			GmlCache.Disable();
+
+		var stages = new List<Stage>();
+		var total = Stopwatch.StartNew();
+
+		UndertaleData data = null!;
+		Measure(stages, "load", () => data = Program.LoadGameData(stream, textureCacheDir));
+
+		List<ModInfo> loadOrder = null!;
+		Measure(stages, "load order", () => loadOrder = Program.BuildLoadOrder(mods));
+
+		foreach (var mod in loadOrder)
+		{
+			Measure(stages, "prepare", () => mod.Instance.PrepareMod(data, mod, mod.ModDir));
+			Measure(stages, "patch", () => mod.Instance.Patch());
+			Measure(stages, "finalize", () => mod.Instance.FinalizeMod());
+		}
+
+		Measure(stages, "write", () =>
+		{
+			Directory.CreateDirectory(Path.GetDirectoryName(Path.GetFullPath(outPath))!);
+			using var output = File.Create(outPath);
+			UndertaleIO.Write(output, data, msg =>
+			{
+				Logger.Info($"[UMT]: {msg}");
+			});
+		});
+
+		total.Stop();
+
+		Logger.Info($"{Path.GetFileName(dataPath)}: {data.Code.Count} code entries, {data.GameObjects.Count} objects, {data.Rooms.Count} rooms, {data.Strings.Count} strings, {data.EmbeddedTextures.Count} texture pages");
+		Logger.Info($"{loadOrder.Count} mods, texture cache {TextureCache.hits} hits / {TextureCache.misses} misses, gml cache {GmlCache.hits} hits / {GmlCache.misses} misses");
+		Logger.Info($"{"stage",-12} {"wall ms",10} {"alloc MB",10} {"heap MB",10} {"peak MB",10}");
+		foreach (var stage in stages)
+		{
+			Logger.Info($"{stage.Name,-12} {stage.Wall.TotalMilliseconds,10:0.0} {stage.Allocated / 1048576.0,10:0.0} {stage.Heap / 1048576.0,10:0.0} {stage.Peak / 1048576.0,10:0.0}");
+		}
+		Logger.Info($"{"total",-12} {total.Elapsed.TotalMilliseconds,10:0.0} {stages.Sum(x => x.Allocated) / 1048576.0,10:0.0} {stages[^1].Heap / 1048576.0,10:0.0} {stages.Max(x => x.Peak) / 1048576.0,10:0.0}");
+
+		if (options.TryGetValue("csv", out var csvPath))
+			WriteCsv(csvPath, Path.GetFileName(dataPath), stages, total.Elapsed);
+
+		if (Directory.Exists(scratch))
+			Directory.Delete(scratch, true);
+	}
+
+	// stages with the same name add up, peak is the process high-water mark when the stage ended
+	private static void Measure(List<Stage> stages, string name, Action action)
+	{
+		var allocated = GC.GetTotalAllocatedBytes();
+		var watch = Stopwatch.StartNew();
+		action();
+		watch.Stop();
+
+		var stage = stages.FirstOrDefault(x => x.Name == name);
+		if (stage == null)
+		{
+			stage = new Stage { Name = name };
+			stages.Add(stage);
+		}
+
+		stage.Wall += watch.Elapsed;
+		stage.Allocated += GC.GetTotalAllocatedBytes() - allocated;
+		stage.Heap = GC.GetTotalMemory(false);
+		using var process = Process.GetCurrentProcess();
+		stage.Peak = process.PeakWorkingSet64;
+	}
+
+	private static void WriteCsv(string path, string dataName, List<Stage> stages, TimeSpan total)
+	{
+		var header = !File.Exists(path);
+		using var writer = File.AppendText(path);
+		if (header) writer.WriteLine("data,stage,wall_ms,allocated_bytes,heap_bytes,peak_bytes");
+		foreach (var stage in stages)
+		{
+			writer.WriteLine(FormattableString.Invariant($"{dataName},{stage.Name},{stage.Wall.TotalMilliseconds:0.000},{stage.Allocated},{stage.Heap},{stage.Peak}"));
+		}
+		writer.WriteLine(FormattableString.Invariant($"{dataName},total,{total.TotalMilliseconds:0.000},{stages.Sum(x => x.Allocated)},{stages[^1].Heap},{stages.Max(x => x.Peak)}"));
+	}
+
+	// --name value pairs, the first bare argument is returned as the positional one
+	private static Dictionary<string, string> ParseOptions(string[] args, out string? positional)
+	{
+		var options = new Dictionary<string, string>();
+		positional = null;
+		for (int i = 0; i < args.Length; i++)
+		{
+			if (args[i].StartsWith("--") && i + 1 < args.Length)
+				options[args[i][2..]] = args[++i];
+			else if (positional == null)
+				positional = args[i];
+		}
+		return options;
+	}
+
+	private static int Int(Dictionary<string, string> options, string name, int fallback)
+	{
+		return options.TryGetValue(name, out var value) && int.TryParse(value, out var parsed) ? parsed : fallback;
+	}
+}
+
+// Stands in for a real mod against a synthesized data.win: hooks its own slice of the synth_fn_* functions (the
+// hooker only takes one hook per function), wraps some object create events and adds an object that calls a hooked
+// function, which covers the compile, hook and FinalizeHooks paths real mods spend their patch time in.
+internal class SyntheticMod : GMSLMod
+{
+	private readonly int _index;
+	private readonly int _count;
+	private readonly int _hooks;
+
+	public SyntheticMod(int index, int count, int hooks)
+	{
+		_index = index;
+		_count = count;
+		_hooks = hooks;
+	}
+
+	public override void Patch()
+	{
+		for (int i = 0; i < _hooks; i++)
+		{
+			var function = $"synth_fn_{_index + i * _count}";
+			if (moddingData.Code.ByNameIndexed($"gml_Script_{function}") == null) break;
+			moddingData.HookFunction(function, $"var result = #orig#(argument0, argument1);\nreturn result + {_index + 1};");
+		}
+
+		for (int i = 0; i < _hooks / 5; i++)
+		{
+			var code = $"gml_Object_obj_synth_{_index + i * _count}_Create_0";
+			if (moddingData.Code.ByNameIndexed(code) == null) break;
+			moddingData.HookCode(code, "#orig#();\nhp += 1;");
+		}
+
+		if (moddingData.Code.ByNameIndexed($"gml_Script_synth_fn_{_index}") != null)
+		{
+			var gameObject = NewObject($"obj_synthetic_mod_{_index}");
+			gameObject.EventHandlerFor(EventType.Step, EventSubtypeStep.Step, moddingData)
+				.ReplaceGmlCached($"x = synth_fn_{_index}(x, y);", moddingData);
+		}
+	}
+
+	public override void Start()
+	{
+	}
+}
@@ -0,0 +1,93 @@
+using System.Reflection;
+using System.Text;
+
+namespace gmsl_patcher;
+
+// cache.interop, written next to cache.win so gmsl-interop can bind every [GmlInterop] method by metadata token
+// in one pass at startup. The entry index is the id the generated script passes to interop_set_id.
+// Layout, little endian:
+//   u32 magic "GMIM", u32 version, u32 assembly count, u32 entry count
+//   per assembly: u16 length + utf8 mod name, u16 length + module version id
+//   per entry: u16 assembly index, u8 signature kind, u8 argc, u32 metadata token
+public class InteropManifest
+{
+	private const uint Magic = 0x4d494d47;
+	private const uint Version = 1;
+
+	public enum SignatureKind : byte
+	{
+		// goes through mono_runtime_invoke with boxed arguments
+		Boxed = 0,
+		// static, at most 4 arguments, only primitive types gmsl-interop can call through an unmanaged thunk
+		Blittable = 1
+	}
+
+	private static readonly HashSet<Type> BlittableTypes = new()
+	{
+		typeof(double), typeof(float), typeof(int), typeof(long), typeof(bool), typeof(IntPtr)
+	};
+
+	private readonly List<(string Name, Guid Mvid)> _assemblies = new();
+	private readonly List<(ushort Assembly, SignatureKind Signature, byte Argc, int Token)> _entries = new();
+
+	public int Count => _entries.Count;
+
+	public int Add(string assembly, MethodInfo method, ushort argc)
+	{
+		var mvid = method.Module.ModuleVersionId;
+		var index = _assemblies.FindIndex(x => x.Name == assembly && x.Mvid == mvid);
+		if (index == -1)
+		{
+			index = _assemblies.Count;
+			_assemblies.Add((assembly, mvid));
+		}
+
+		_entries.Add(((ushort)index, Classify(method), (byte)argc, method.MetadataToken));
+		return _entries.Count - 1;
+	}
+
+	public static SignatureKind Classify(MethodInfo method)
+	{
+		if (!method.IsStatic) return SignatureKind.Boxed;
+
+		var parameters = method.GetParameters();
+		if (parameters.Length > 4) return SignatureKind.Boxed;
+		if (method.ReturnType != typeof(void) && !BlittableTypes.Contains(method.ReturnType)) return SignatureKind.Boxed;
+		if (parameters.Any(x => !BlittableTypes.Contains(x.ParameterType))) return SignatureKind.Boxed;
+
+		return SignatureKind.Blittable;
+	}
+
+	public void Write(string path)
+	{
+		using var stream = File.Create(path);
+		using var writer = new BinaryWriter(stream, Encoding.UTF8);
+
+		writer.Write(Magic);
+		writer.Write(Version);
+		writer.Write((uint)_assemblies.Count);
+		writer.Write((uint)_entries.Count);
+
+		foreach (var assembly in _assemblies)
+		{
+			WriteString(writer, assembly.Name);
+			// mono_image_get_guid formats the module version id the same way, up to case
+			WriteString(writer, assembly.Mvid.ToString("D").ToUpperInvariant());
+		}
+
+		foreach (var entry in _entries)
+		{
+			writer.Write(entry.Assembly);
+			writer.Write((byte)entry.Signature);
+			writer.Write(entry.Argc);
+			writer.Write(entry.Token);
+		}
+	}
+
+	private static void WriteString(BinaryWriter writer, string str)
+	{
+		var bytes = Encoding.UTF8.GetBytes(str);
+		writer.Write((ushort)bytes.Length);
+		writer.Write(bytes);
+	}
+}
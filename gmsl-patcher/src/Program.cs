@@ -8,6 +8,7 @@ using System.Text.Json;
 using System.Runtime.InteropServices;
 using System.Security.Cryptography;
 using GMSL;
+using GMSL.Hooker;
 using GMSL.Logger;
 
 namespace gmsl_patcher;
@@ -15,6 +16,7 @@ namespace gmsl_patcher;
 public static class Program
 {
 	private static UndertaleExtensionFile _interopExtension = null!;
+	private static InteropManifest _interopManifest = new();
 	private static List<string> _whitelist = new();
 	private static List<string> _blacklist = new();
 
@@ -26,6 +28,18 @@ public static class Program
 
 	public static void Main(string[] args)
 	{
+		// headless modes for measuring the patch pipeline, they never touch a game install
+		if (args.Length > 0 && args[0] == "--synthesize")
+		{
+			Benchmark.Synthesize(args[1..]);
+			return;
+		}
+		if (args.Length > 0 && args[0] == "--benchmark")
+		{
+			Benchmark.Run(args[1..]);
+			return;
+		}
+
 		if (!args.Contains("-gmsl_console") && RuntimeInformation.IsOSPlatform(OSPlatform.Windows))
 			ShowWindow(GetConsoleWindow(), 0);
 
@@ -76,27 +90,13 @@ public static class Program
 
 		loaderState += $"+VSLoader[{loaderVer}]";
 
-		List<ModInfo> mods = new();
+		// gmsl-interop is opt in, with it the data gets the interop extension, the tick object that drives
+		// interop_tick (tick callbacks, jobs, gc telemetry and the key-value store's collect) and a script per
+		// [GmlInterop] method. Part of the loader state so switching it rebuilds cache.win
+		var interop = args.Contains("-gmsl_interop");
+		if (interop) loaderState += "+interop";
 
-		foreach (var mod in modDirs)
-		{
-			var modInfoPath = Path.Combine(mod, "modinfo.json");
-			if (!File.Exists(modInfoPath))
-			{
-				Logger.Warn($"Not loading mod {mod} because it doesn't have a modinfo.json");
-				continue;
-			}
-
-			var info = JsonSerializer.Deserialize<ModInfo>(File.ReadAllText(modInfoPath));
-
-			if (info == null)
-			{
-				Logger.Warn($"Not loading mod {mod} because it's modinfo is invalid");
-				continue;
-			}
-			info.ModDir = mod;
-			mods.Add(info);
-		}
+		var mods = LoadModInfos(modDirs);
 
 		Logger.Info("Got mods:");
 		foreach (var mod in mods)
@@ -124,7 +124,12 @@ public static class Program
 
 			if (!File.Exists(modPath))
 			{
-				Logger.Error($"Error loading mod {mod.ID} cant find {modPath}");
+				// native code and assets only, gmsl-interop loads those itself and there's nothing to patch or start
+				var nativePath = Path.Combine(mod.ModDir, mod.Name + (RuntimeInformation.IsOSPlatform(OSPlatform.Windows) ? ".native.dll" : ".native.so"));
+				if (File.Exists(nativePath) || Directory.Exists(Path.Combine(mod.ModDir, "assets")))
+					Logger.Info($"Mod {mod.ID} has no assembly, loading its native code and assets only");
+				else
+					Logger.Error($"Error loading mod {mod.ID} cant find {modPath}");
 				continue;
 			}
 
@@ -146,8 +151,7 @@ public static class Program
 
 			foreach (var type in modAssembly.GetTypes())
 			{
-				// TODO this is absolutely horrible
-				if (type.GetMethod("Patch") != null && type.GetMethod("Start") != null)
+				if (IsModType(type))
 				{
 					try
 					{
@@ -176,24 +180,50 @@ public static class Program
 				}
 			}
 		}
+
+		// independent of the loader state, a pack only gets rewritten when its mod's assets directory changed
+		Logger.Info("Packing mod assets...");
+		var assetPackDir = Path.Combine(gmslDir!, "cache", "assets");
+		Parallel.ForEach(loadOrder, mod =>
+		{
+			try
+			{
+				AssetPack.Build(Path.Combine(mod.ModDir, "assets"), Path.Combine(assetPackDir, mod.Name + ".pack"));
+			}
+			catch (Exception ex)
+			{
+				Logger.Error($"Couldn't pack assets for {mod.ID}: {ex.Message}");
+			}
+		});
+
 		Logger.Info($"Loader state: {loaderState}");
 
 		if (loaderState != prevLoaderState)
 		{
 			Logger.Info("Loader state differs, rebuilding data.win...");
 
-			var data = LoadGameData(stream, uncompressedDataPath, baseState != prevBaseState);
+			var data = LoadGameData(stream, Path.Combine(gmslDir!, "cache", "textures"));
+
+			// superseded by the per page texture cache
+			if (File.Exists(uncompressedDataPath))
+				File.Delete(uncompressedDataPath);
 
 			if (File.Exists(Path.Combine(baseDir!, "cache.win")))
 				File.Delete(Path.Combine(baseDir!, "cache.win"));
+			if (File.Exists(Path.Combine(baseDir!, "cache.interop")))
+				File.Delete(Path.Combine(baseDir!, "cache.interop"));
 
 			Logger.Info("Writing new base state...");
 			File.WriteAllText(baseStatePath, baseState);
 
-			// SetupInterop(data, baseDir!);
+			if (interop) SetupInterop(data, baseDir!);
+
+			GmlCache.Init(Path.Combine(gmslDir!, "cache", "gml"), dataHash);
 
 			foreach (var mod in loadOrder)
 			{
+				if (mod.Instance == null) continue;
+
 				try
 				{
 					mod.Instance.PrepareMod(data, mod, mod.ModDir);
@@ -221,23 +251,27 @@ public static class Program
 					return;
 				}
 
-				//foreach (var type in mod.Assembly.GetTypes())
-				//{
-				//	foreach (var method in type.GetMembers())
-				//	{
-				//		var interop = method.GetCustomAttribute<GmlInterop>();
-				//		if (interop == null) continue;
-
-				//		CreateInteropFunction(
-				//			interop,
-				//			method,
-				//			mod.Name,
-				//			data
-				//		);
-				//	}
-				//}
+				if (!interop) continue;
+
+				foreach (var type in mod.Assembly.GetTypes())
+				{
+					foreach (var method in type.GetMethods())
+					{
+						var gmlInterop = method.GetCustomAttribute<GmlInterop>();
+						if (gmlInterop == null) continue;
+
+						CreateInteropFunction(
+							gmlInterop,
+							method,
+							mod.Name,
+							data
+						);
+					}
+				}
 			}
 
+			Logger.Info($"Compiled gml cache: {GmlCache.hits} hits, {GmlCache.misses} misses");
+
 			Logger.Info("Saving modified data.win...");
 			stream = File.OpenWrite(Path.Combine(baseDir!, "cache.win"));
 			UndertaleIO.Write(stream, data, msg =>
@@ -245,6 +279,12 @@ public static class Program
 				Logger.Info($"[UMT]: {msg}");
 			});
 			stream.Dispose();
+
+			if (interop)
+			{
+				Logger.Info($"Writing interop manifest ({_interopManifest.Count} methods)...");
+				_interopManifest.Write(Path.Combine(baseDir!, "cache.interop"));
+			}
 		}
 		else
 		{
@@ -254,6 +294,8 @@ public static class Program
 
 		foreach (var mod in loadOrder)
 		{
+			if (mod.Instance == null) continue;
+
 			try
 			{
 				mod.Instance.Start();
@@ -288,11 +330,39 @@ public static class Program
 		StartGame(args, baseDir!);
 	}
 
-	private static UndertaleData LoadGameData(Stream dataStream, string uncompressedTxtrPath, bool needToDecompress)
+	internal static List<ModInfo> LoadModInfos(string[] modDirs)
+	{
+		List<ModInfo> mods = new();
+
+		foreach (var mod in modDirs)
+		{
+			var modInfoPath = Path.Combine(mod, "modinfo.json");
+			if (!File.Exists(modInfoPath))
+			{
+				Logger.Warn($"Not loading mod {mod} because it doesn't have a modinfo.json");
+				continue;
+			}
+
+			var info = JsonSerializer.Deserialize<ModInfo>(File.ReadAllText(modInfoPath));
+
+			if (info == null)
+			{
+				Logger.Warn($"Not loading mod {mod} because it's modinfo is invalid");
+				continue;
+			}
+			info.ModDir = mod;
+			mods.Add(info);
+		}
+
+		return mods;
+	}
+
+	// TODO this is absolutely horrible
+	internal static bool IsModType(Type type) => type.GetMethod("Patch") != null && type.GetMethod("Start") != null;
+
+	internal static UndertaleData LoadGameData(Stream stream, string textureCacheDir)
 	{
 		UndertaleData data;
-		if (!needToDecompress) Logger.Info("Using cached copy of game data with uncompressed TXTR...");
-		var stream = needToDecompress ? dataStream : File.OpenRead(uncompressedTxtrPath);
 
 		Logger.Info("Reading data.win...");
 		data = UndertaleIO.Read(stream, Logger.Error, msg =>
@@ -304,35 +374,14 @@ public static class Program
 		Logger.Info("Building global function cache");
 		GlobalDecompileContext.BuildGlobalFunctionCache(data);
 
-		if (needToDecompress)
-		{
-			Logger.Info("Disabling texture compression");
-			foreach (var texture in data.EmbeddedTextures)
-			{
-				if (texture != null)
-				{
-					// texture.TextureData.FormatBZ2 = false;
-					// texture.TextureData.FormatQOI = false;
-				}
-			}
-
-			Logger.Info("Writing data.uncompressed.win");
-			
-			if (File.Exists(uncompressedTxtrPath))
-				File.Delete(uncompressedTxtrPath);
-			
-			var writeStream = File.OpenWrite(uncompressedTxtrPath);
-			UndertaleIO.Write(writeStream, data, msg =>
-			{
-				Logger.Info($"[UMT]: {msg}");
-			});
-			writeStream.Dispose();
-		}
+		Logger.Info("Disabling texture compression");
+		TextureCache.DecompressTextures(data, textureCacheDir);
+		Logger.Info($"Texture cache: {TextureCache.hits} hits, {TextureCache.misses} misses");
 
 		return data;
 	}
 
-	private static string HashFile(FileStream stream)
+	internal static string HashFile(FileStream stream)
 	{
 		using (var md5 = MD5.Create())
 		{
@@ -350,7 +399,7 @@ public static class Program
 		}
 	}
 
-	private static List<ModInfo> BuildLoadOrder(List<ModInfo> mods)
+	internal static List<ModInfo> BuildLoadOrder(List<ModInfo> mods)
 	{
 		var order = new List<ModInfo>();
 		bool useWhitelist = _whitelist.Count > 0;
@@ -387,8 +436,9 @@ public static class Program
 		return order;
 	}
 
-	private static void CreateInteropFunction(GmlInterop interop, MemberInfo method, string file, UndertaleData data)
+	private static void CreateInteropFunction(GmlInterop interop, MethodInfo method, string file, UndertaleData data)
 	{
+		var id = _interopManifest.Add(file, method, interop.Argc);
 		UndertaleExtensionFunction function = new()
 		{
 			Name = data.Strings.MakeString($"{interop.Name}_interop"),
@@ -405,7 +455,8 @@ public static class Program
 		CreateLegacyScript(
 			data,
 			interop.Name,
-			$"interop_set_function(\"{file}\", \"{method.DeclaringType!.Namespace}\", \"{method.DeclaringType.Name}\", \"{method.Name}\", {interop.Argc});\nreturn {interop.Name}_interop({args});",
+			// a missing, stale or cut short cache.interop leaves the id unbound, then the method is resolved by name
+			$"if (!interop_set_id({id})) interop_set_function(\"{file}\", \"{method.DeclaringType!.Namespace}\", \"{method.DeclaringType.Name}\", \"{method.Name}\", {interop.Argc});\nreturn {interop.Name}_interop({args});",
 			interop.Argc);
 	}
 
@@ -413,13 +464,7 @@ public static class Program
 	{
 		Extension.Init(data);
 
-		UndertaleExtensionFunction setFunction = new()
-		{
-			Name = data.Strings.MakeString("interop_set_function"),
-			ExtName = data.Strings.MakeString("interop_set_function"),
-			Kind = 11,
-			ID = Extension.NextId()
-		};
+		UndertaleExtensionFunction setFunction = CreateExtensionFunction(data, "interop_set_function");
 
 		UndertaleExtensionFile extensionFile = new()
 		{
@@ -429,6 +474,43 @@ public static class Program
 			CleanupScript = data.Strings.MakeString("")
 		};
 		extensionFile.Functions.Add(setFunction);
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_set_id"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_tick"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_tick_count"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_tick_name"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_tick_time"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_tick_heaviest"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_tick_report"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_gc_stat"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_job_start"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_job_status"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_job_progress"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_job_time"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_job_cancel"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_job_free"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_scheduler_budget"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_kv_key"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_kv_set"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_kv_get"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_kv_exists"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_kv_remove"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_log"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_log_level"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_buffer_map"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_buffer_reduce"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_buffer_scan"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_buffer_filter"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_simd_level"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_trace_start"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_trace_stop"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_asset_exists"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_asset_size"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_asset_load"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_asset_ptr"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_asset_count"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_asset_name"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_native_id"));
+		extensionFile.Functions.Add(CreateExtensionFunction(data, "interop_native_call"));
 
 		UndertaleExtension interop = new()
 		{
@@ -441,6 +523,45 @@ public static class Program
 		data.Extensions.Add(interop);
 
 		_interopExtension = extensionFile;
+
+		SetupTickObject(data);
+	}
+
+	private static UndertaleExtensionFunction CreateExtensionFunction(UndertaleData data, string name)
+	{
+		return new UndertaleExtensionFunction()
+		{
+			Name = data.Strings.MakeString(name),
+			ExtName = data.Strings.MakeString(name),
+			Kind = 11,
+			ID = Extension.NextId()
+		};
+	}
+
+	// a persistent instance in the first room that calls interop_tick once per step for every registered mod callback
+	private static void SetupTickObject(UndertaleData data)
+	{
+		UndertaleGameObject tickObject = new()
+		{
+			Name = data.Strings.MakeString("gmsl_tick"),
+			Persistent = true,
+			Visible = false
+		};
+		data.GameObjects.AddIndexed(tickObject);
+		tickObject.EventHandlerFor(EventType.Step, EventSubtypeStep.BeginStep, data).ReplaceGML("interop_tick();", data);
+
+		var room = data.GeneralInfo.RoomOrder[0].Resource;
+		UndertaleRoom.GameObject tickInstance = new()
+		{
+			InstanceID = data.GeneralInfo.LastObj,
+			ObjectDefinition = tickObject,
+			X = -120,
+			Y = -120
+		};
+		data.GeneralInfo.LastObj++;
+
+		room.GameObjects.Add(tickInstance);
+		room.Layers.FirstOrDefault(layer => layer.LayerType == UndertaleRoom.LayerType.Instances)?.InstancesData.Instances.Add(tickInstance);
 	}
 
 	private static UndertaleCode CreateCode(UndertaleData data, UndertaleString name, out UndertaleCodeLocals locals)
@@ -0,0 +1,244 @@
+using System.Globalization;
+using System.IO.Compression;
+using System.Text;
+using GMSL.Hooker;
+using GMSL.Logger;
+using UndertaleModLib;
+using UndertaleModLib.Decompiler;
+using UndertaleModLib.Models;
+using UndertaleModLib.Util;
+
+namespace gmsl_patcher;
+
+public class SyntheticOptions
+{
+	public int Functions = 2000;
+	public int Objects = 500;
+	public int Rooms = 50;
+	public int Instances = 100;
+	public int Strings = 20000;
+	public int TexturePages = 8;
+	public int TextureSize = 2048;
+	public int Seed = 1;
+}
+
+// A GameMaker data file with the shape of a real game but none of its content, so the patch pipeline can be
+// benchmarked without shipping a commercial data.win. Everything comes from one seeded Random, the same options
+// always produce the same file. Functions are 2.3 style global functions named synth_fn_<i>, which is what the
+// synthetic mods in Benchmark.cs hook; objects call them from their step events so FinalizeHooks has call sites
+// to rewrite.
+public static class SyntheticData
+{
+	public static UndertaleData Generate(SyntheticOptions options)
+	{
+		var random = new Random(options.Seed);
+		var data = UndertaleData.CreateNew();
+		data.GeneralInfo.BytecodeVersion = 17;
+		data.SetGMS2Version(2023, 6);
+
+		Logger.Info($"Generating {options.Functions} functions...");
+		for (int i = 0; i < options.Functions; i++)
+		{
+			data.CreateFunction($"synth_fn_{i}", FunctionSource(random, i), 2);
+		}
+
+		// objects resolve synth_fn_* by name, which needs the new functions in the cache
+		GlobalDecompileContext.BuildGlobalFunctionCache(data);
+
+		Logger.Info($"Generating {options.Objects} objects...");
+		var objects = new List<UndertaleGameObject>();
+		for (int i = 0; i < options.Objects; i++)
+		{
+			var name = new UndertaleString($"obj_synth_{i}");
+			data.Strings.Add(name);
+			var gameObject = new UndertaleGameObject
+			{
+				Name = name,
+				Visible = true
+			};
+			data.GameObjects.AddIndexed(gameObject);
+			objects.Add(gameObject);
+
+			gameObject.EventHandlerFor(EventType.Create, data).ReplaceGML(
+				$"hp = {random.Next(1, 1000)};\nrate = {random.NextDouble().ToString("0.000", CultureInfo.InvariantCulture)};\ntag = \"{Word(random)}\";", data);
+			if (options.Functions > 0)
+			{
+				gameObject.EventHandlerFor(EventType.Step, EventSubtypeStep.Step, data).ReplaceGML(
+					$"hp = synth_fn_{random.Next(options.Functions)}(hp, rate);\nif (hp > {random.Next(10000, 100000)})\n    hp = 0;", data);
+			}
+		}
+
+		Logger.Info($"Generating {options.Rooms} rooms...");
+		for (int i = 0; i < options.Rooms && objects.Count > 0; i++)
+		{
+			var name = new UndertaleString($"rm_synth_{i}");
+			data.Strings.Add(name);
+			var layerName = new UndertaleString("Instances");
+			data.Strings.Add(layerName);
+
+			var layer = new UndertaleRoom.Layer
+			{
+				LayerName = layerName,
+				LayerType = UndertaleRoom.LayerType.Instances,
+				Data = new UndertaleRoom.Layer.LayerInstancesData()
+			};
+			var room = new UndertaleRoom
+			{
+				Name = name,
+				Width = 1920,
+				Height = 1080
+			};
+			room.Layers.Add(layer);
+
+			for (int j = 0; j < options.Instances; j++)
+			{
+				var instance = new UndertaleRoom.GameObject
+				{
+					InstanceID = data.GeneralInfo.LastObj++,
+					ObjectDefinition = objects[random.Next(objects.Count)],
+					X = random.Next(1920),
+					Y = random.Next(1080)
+				};
+				room.GameObjects.Add(instance);
+				layer.InstancesData.Instances.Add(instance);
+			}
+
+			data.Rooms.AddIndexed(room);
+			data.GeneralInfo.RoomOrder.Add(new() { Resource = room });
+		}
+
+		// MakeString searches the whole list, these are unique so they go straight in
+		Logger.Info($"Generating {options.Strings} strings...");
+		for (int i = 0; i < options.Strings; i++)
+		{
+			data.Strings.Add(new UndertaleString($"synth_{i}_{Word(random)}"));
+		}
+
+		Logger.Info($"Generating {options.TexturePages} texture pages...");
+		for (int i = 0; i < options.TexturePages; i++)
+		{
+			var png = TexturePage(random, options.TextureSize);
+			data.EmbeddedTextures.Add(new UndertaleEmbeddedTexture
+			{
+				Name = new UndertaleString($"Texture {i}"),
+				TextureData = new UndertaleEmbeddedTexture.TexData
+				{
+					// qoi like the pages of current games, so loading goes through the texture cache
+					Image = GMImage.FromPng(png, true).ConvertToFormat(GMImage.ImageFormat.Qoi)
+				}
+			});
+		}
+
+		return data;
+	}
+
+	private static string FunctionSource(Random random, int index)
+	{
+		return $$"""
+			var a = argument0;
+			var b = argument1;
+			var total = 0;
+			for (var i = 0; i < {{random.Next(2, 16)}}; i++)
+			{
+			    total += (a * {{random.Next(2, 50)}} + b) mod {{random.Next(51, 997)}};
+			}
+			if (total > {{random.Next(100, 5000)}})
+			    total = floor(total / {{random.Next(2, 9)}});
+			else
+			    total += string_length("{{Word(random)}}");
+			global.synth_counter_{{index % 64}} = total;
+			return total;
+			""";
+	}
+
+	private static string Word(Random random)
+	{
+		var word = new char[random.Next(4, 16)];
+		for (int i = 0; i < word.Length; i++)
+		{
+			word[i] = (char)('a' + random.Next(26));
+		}
+		return new string(word);
+	}
+
+	// atlas-like: solid blocks of colour with transparent gaps, which compresses about as well as real sprite pages
+	private static byte[] TexturePage(Random random, int size)
+	{
+		const int block = 32;
+		var rows = new byte[size * (size * 4 + 1)];
+		var colours = new uint[(size / block + 1) * (size / block + 1)];
+		for (int i = 0; i < colours.Length; i++)
+		{
+			colours[i] = random.Next(4) == 0 ? 0 : (uint)random.Next() | 0xff000000;
+		}
+
+		for (int y = 0; y < size; y++)
+		{
+			int row = y * (size * 4 + 1);
+			rows[row] = 0;
+			for (int x = 0; x < size; x++)
+			{
+				uint colour = colours[(y / block) * (size / block + 1) + x / block];
+				int pixel = row + 1 + x * 4;
+				rows[pixel] = (byte)colour;
+				rows[pixel + 1] = (byte)(colour >> 8);
+				rows[pixel + 2] = (byte)(colour >> 16);
+				rows[pixel + 3] = (byte)(colour >> 24);
+			}
+		}
+
+		using var png = new MemoryStream();
+		png.Write(new byte[] { 0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a });
+
+		var header = new byte[13];
+		WriteBigEndian(header, 0, (uint)size);
+		WriteBigEndian(header, 4, (uint)size);
+		header[8] = 8; // bits per channel
+		header[9] = 6; // rgba
+		WriteChunk(png, "IHDR", header);
+
+		using (var compressed = new MemoryStream())
+		{
+			using (var zlib = new ZLibStream(compressed, CompressionLevel.Fastest, true))
+			{
+				zlib.Write(rows);
+			}
+			WriteChunk(png, "IDAT", compressed.ToArray());
+		}
+
+		WriteChunk(png, "IEND", Array.Empty<byte>());
+		return png.ToArray();
+	}
+
+	private static void WriteChunk(Stream stream, string type, byte[] content)
+	{
+		var buffer = new byte[content.Length + 12];
+		WriteBigEndian(buffer, 0, (uint)content.Length);
+		Encoding.ASCII.GetBytes(type, 0, 4, buffer, 4);
+		content.CopyTo(buffer, 8);
+		WriteBigEndian(buffer, content.Length + 8, Crc32(buffer.AsSpan(4, content.Length + 4)));
+		stream.Write(buffer);
+	}
+
+	private static void WriteBigEndian(byte[] buffer, int offset, uint value)
+	{
+		buffer[offset] = (byte)(value >> 24);
+		buffer[offset + 1] = (byte)(value >> 16);
+		buffer[offset + 2] = (byte)(value >> 8);
+		buffer[offset + 3] = (byte)value;
+	}
+
+	private static uint Crc32(ReadOnlySpan<byte> bytes)
+	{
+		uint crc = 0xffffffff;
+		foreach (var b in bytes)
+		{
+			crc ^= b;
+			for (int i = 0; i < 8; i++)
+			{
+				crc = (crc >> 1) ^ (0xedb88320 & (uint)-(int)(crc & 1));
+			}
+		}
+		return ~crc;
+	}
+}
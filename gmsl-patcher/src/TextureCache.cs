@@ -0,0 +1,75 @@
+using System.Collections.Concurrent;
+using System.Security.Cryptography;
+using GMSL.Logger;
+using UndertaleModLib;
+using UndertaleModLib.Util;
+
+namespace gmsl_patcher;
+
+// Decoded texture pages, stored as <sha256 of the compressed page>.png. The key only depends on the page itself,
+// so the cache is shared by every data.win revision and a game update only decodes the pages it changed.
+public static class TextureCache
+{
+	public static int hits;
+	public static int misses;
+
+	public static void DecompressTextures(UndertaleData data, string directory)
+	{
+		Directory.CreateDirectory(directory);
+		hits = 0;
+		misses = 0;
+
+		var failed = new ConcurrentBag<string>();
+		Parallel.ForEach(data.EmbeddedTextures, texture =>
+		{
+			var image = texture?.TextureData?.Image;
+			if (image == null) return;
+			if (image.Format != GMImage.ImageFormat.Qoi && image.Format != GMImage.ImageFormat.Bz2Qoi) return;
+
+			try
+			{
+				texture!.TextureData.Image = Load(image, directory);
+			}
+			catch (Exception ex)
+			{
+				// the page just stays compressed, the game can still read it
+				failed.Add($"{texture!.Name?.Content}: {ex.Message}");
+			}
+		});
+
+		foreach (var error in failed)
+		{
+			Logger.Warn($"Couldn't decompress texture page {error}");
+		}
+	}
+
+	private static GMImage Load(GMImage image, string directory)
+	{
+		var hash = Convert.ToHexString(SHA256.HashData(image.ToSpan())).ToLower();
+		var path = Path.Combine(directory, hash + ".png");
+
+		if (File.Exists(path))
+		{
+			try
+			{
+				var cached = GMImage.FromPng(File.ReadAllBytes(path), true);
+				Interlocked.Increment(ref hits);
+				return cached;
+			}
+			catch (Exception)
+			{
+				// truncated or otherwise broken entry, decode again and replace it
+			}
+		}
+
+		var decoded = image.ConvertToPng();
+		Interlocked.Increment(ref misses);
+
+		// written under a temporary name so a crash never leaves a half written page behind
+		var temp = path + "." + Environment.CurrentManagedThreadId + ".tmp";
+		File.WriteAllBytes(temp, decoded.ToSpan().ToArray());
+		File.Move(temp, path, true);
+
+		return decoded;
+	}
+}
@@ -0,0 +1,464 @@
+// Replays an interop trace recorded with interop_trace_start / GMSL_TRACE outside the game. The interop module is
+// loaded as-is and driven through a stand-in runner interface, so it starts mono and loads gmsl/mods the same way it
+// does in game; run it from the game directory.
+//
+//   gmsl-replay <trace> [--module path] [--runs n] [--warmup n]
+
+#include "extensions/Extension_Interface.h"
+#include "extensions/YYRValue.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+#ifdef OS_Windows
+#include <windows.h>
+#define REPLAY_DEFAULT_MODULE "gmsl/interop/gmsl-interop.dll"
+#else
+#include <dlfcn.h>
+#define REPLAY_DEFAULT_MODULE "gmsl/interop/gmsl-interop.so"
+#endif
+
+// RefString::dec references these, the runner provides them in game
+void LOCK_RVALUE_MUTEX() {}
+void UNLOCK_RVALUE_MUTEX() {}
+
+struct TraceMethod
+{
+    std::string dll;
+    std::string ns;
+    std::string clazz;
+    std::string method;
+    int argc = 0;
+    RValue names[5];
+};
+
+struct TraceCall
+{
+    uint32_t method;
+    uint64_t duration;
+    uint8_t flags;
+    std::vector<RValue> args;
+};
+
+struct MethodStats
+{
+    uint32_t calls = 0;
+    uint32_t failed = 0;
+    std::vector<uint64_t> recorded;
+    std::vector<uint64_t> replayed;
+};
+
+// stand-in runner, only what the interop module calls
+
+static void replay_print(const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+}
+
+static void replay_error(const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+static void replay_show_message(const char* msg)
+{
+    fprintf(stderr, "%s\n", msg);
+}
+
+static void* replay_alloc(int size)
+{
+    return malloc(size);
+}
+
+static void* replay_realloc(void* original, int size)
+{
+    return realloc(original, size);
+}
+
+static void replay_free(const void* p)
+{
+    free((void*)p);
+}
+
+static const char* replay_strdup(const char* s)
+{
+    size_t length = strlen(s) + 1;
+    char* copy = (char*)malloc(length);
+    memcpy(copy, s, length);
+    return copy;
+}
+
+static void replay_create_string(RValue* value, const char* s)
+{
+    value->kind = VALUE_STRING;
+    value->flags = 0;
+    value->pRefString = new RefString(replay_strdup(s));
+}
+
+static void replay_free_rvalue(RValue* value)
+{
+    if ((value->kind & MASK_KIND_RVALUE) == VALUE_STRING && value->pRefString != NULL)
+    {
+        if (--value->pRefString->m_refCount == 0)
+        {
+            replay_free(value->pRefString->m_thing);
+            ::operator delete(value->pRefString);
+        }
+    }
+    value->kind = VALUE_UNDEFINED;
+    value->ptr = NULL;
+}
+
+static void replay_copy_rvalue(RValue* dest, const RValue* source)
+{
+    *dest = *source;
+    if ((dest->kind & MASK_KIND_RVALUE) == VALUE_STRING && dest->pRefString != NULL) dest->pRefString->inc();
+}
+
+static int replay_kind_rvalue(const RValue* value)
+{
+    return value->kind & MASK_KIND_RVALUE;
+}
+
+static double replay_real_rvalue(const RValue* value)
+{
+    switch (value->kind & MASK_KIND_RVALUE)
+    {
+    case VALUE_REAL:
+    case VALUE_BOOL:
+        return value->val;
+    case VALUE_INT32:
+        return value->v32;
+    case VALUE_INT64:
+        return (double)value->v64;
+    case VALUE_STRING:
+        return strtod(value->GetString(), NULL);
+    default:
+        return 0;
+    }
+}
+
+static int64 replay_int64_rvalue(const RValue* value)
+{
+    switch (value->kind & MASK_KIND_RVALUE)
+    {
+    case VALUE_INT32:
+        return value->v32;
+    case VALUE_INT64:
+        return value->v64;
+    case VALUE_PTR:
+        return (int64)(intptr_t)value->ptr;
+    default:
+        return (int64)replay_real_rvalue(value);
+    }
+}
+
+static int32_t replay_int32_rvalue(const RValue* value)
+{
+    return (int32_t)replay_int64_rvalue(value);
+}
+
+static bool replay_bool_rvalue(const RValue* value)
+{
+    return replay_real_rvalue(value) > 0.5;
+}
+
+static void* replay_ptr_rvalue(const RValue* value)
+{
+    return (value->kind & MASK_KIND_RVALUE) == VALUE_PTR ? value->ptr : (void*)(intptr_t)replay_int64_rvalue(value);
+}
+
+static bool replay_get_bool(const RValue* base, int index) { return replay_bool_rvalue(base + index); }
+static float replay_get_float(const RValue* base, int index) { return (float)replay_real_rvalue(base + index); }
+static double replay_get_real(const RValue* base, int index) { return replay_real_rvalue(base + index); }
+static int32_t replay_get_int32(const RValue* base, int index) { return replay_int32_rvalue(base + index); }
+static uint32_t replay_get_uint32(const RValue* base, int index) { return (uint32_t)replay_int64_rvalue(base + index); }
+static int64 replay_get_int64(const RValue* base, int index) { return replay_int64_rvalue(base + index); }
+static void* replay_get_ptr(const RValue* base, int index) { return replay_ptr_rvalue(base + index); }
+static intptr_t replay_get_ptr_or_int(const RValue* base, int index) { return (intptr_t)replay_ptr_rvalue(base + index); }
+static const char* replay_get_string(const RValue* base, int index) { return base[index].GetString(); }
+
+static int64 replay_time()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void replay_sleep(int64 slp, bool)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(slp));
+}
+
+static YYRunnerInterface replay_runner()
+{
+    YYRunnerInterface runner{};
+    runner.DebugConsoleOutput = replay_print;
+    runner.ReleaseConsoleOutput = replay_print;
+    runner.ShowMessage = replay_show_message;
+    runner.YYError = replay_error;
+    runner.YYAlloc = replay_alloc;
+    runner.YYRealloc = replay_realloc;
+    runner.YYFree = replay_free;
+    runner.YYStrDup = replay_strdup;
+    runner.YYGetBool = replay_get_bool;
+    runner.YYGetFloat = replay_get_float;
+    runner.YYGetReal = replay_get_real;
+    runner.YYGetInt32 = replay_get_int32;
+    runner.YYGetUint32 = replay_get_uint32;
+    runner.YYGetInt64 = replay_get_int64;
+    runner.YYGetPtr = replay_get_ptr;
+    runner.YYGetPtrOrInt = replay_get_ptr_or_int;
+    runner.YYGetString = replay_get_string;
+    runner.BOOL_RValue = replay_bool_rvalue;
+    runner.REAL_RValue = replay_real_rvalue;
+    runner.PTR_RValue = replay_ptr_rvalue;
+    runner.INT64_RValue = replay_int64_rvalue;
+    runner.INT32_RValue = replay_int32_rvalue;
+    runner.COPY_RValue = replay_copy_rvalue;
+    runner.KIND_RValue = replay_kind_rvalue;
+    runner.FREE_RValue = replay_free_rvalue;
+    runner.YYCreateString = replay_create_string;
+    runner.Timing_Time = replay_time;
+    runner.Timing_Sleep = replay_sleep;
+    return runner;
+}
+
+static const TraceReplayApi* load_module(const char* path)
+{
+#ifdef OS_Windows
+    HMODULE module = LoadLibraryA(path);
+    if (!module) return nullptr;
+    auto api = (const TraceReplayApi* (*)())GetProcAddress(module, "interop_replay_api");
+#else
+    void* module = dlopen(path, RTLD_NOW);
+    if (!module)
+    {
+        fprintf(stderr, "%s\n", dlerror());
+        return nullptr;
+    }
+    auto api = (const TraceReplayApi* (*)())dlsym(module, "interop_replay_api");
+#endif
+    return api ? api() : nullptr;
+}
+
+static bool read_trace(const char* path, std::vector<TraceMethod>& methods, std::vector<TraceCall>& calls)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        fprintf(stderr, "Couldn't open %s\n", path);
+        return false;
+    }
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    TraceReader reader{bytes.data(), bytes.data() + bytes.size()};
+    if (reader.u32() != TRACE_MAGIC || reader.u32() != TRACE_VERSION)
+    {
+        fprintf(stderr, "%s isn't a version %d interop trace\n", path, TRACE_VERSION);
+        return false;
+    }
+
+    while (!reader.done())
+    {
+        uint8_t record = reader.u8();
+        if (record == TRACE_METHOD)
+        {
+            uint32_t id = (uint32_t)reader.varint();
+            if (id >= methods.size()) methods.resize(id + 1);
+            TraceMethod& method = methods[id];
+            method.argc = (int)reader.varint();
+            method.dll = reader.str();
+            method.ns = reader.str();
+            method.clazz = reader.str();
+            method.method = reader.str();
+        }
+        else if (record == TRACE_CALL)
+        {
+            TraceCall call;
+            call.method = (uint32_t)reader.varint();
+            reader.varint(); // start delta, replay runs calls back to back
+            call.duration = reader.varint();
+            call.flags = reader.u8();
+            call.args.resize((size_t)reader.varint());
+            for (RValue& arg : call.args)
+            {
+                arg = {};
+                switch (reader.u8())
+                {
+                case TRACE_ARG_REAL:
+                    arg.kind = VALUE_REAL;
+                    arg.val = reader.f64();
+                    break;
+                case TRACE_ARG_BOOL:
+                    arg.kind = VALUE_BOOL;
+                    arg.val = reader.f64();
+                    break;
+                case TRACE_ARG_INT32:
+                    arg.kind = VALUE_INT32;
+                    arg.v32 = (int32)reader.svarint();
+                    break;
+                case TRACE_ARG_INT64:
+                    arg.kind = VALUE_INT64;
+                    arg.v64 = reader.svarint();
+                    break;
+                case TRACE_ARG_STRING:
+                    replay_create_string(&arg, reader.str().c_str());
+                    break;
+                default:
+                    arg.kind = VALUE_UNDEFINED;
+                    break;
+                }
+            }
+            if (reader.failed || call.method >= methods.size())
+            {
+                for (RValue& arg : call.args) replay_free_rvalue(&arg);
+                break;
+            }
+            calls.push_back(std::move(call));
+        }
+        else if (!reader.failed)
+        {
+            fprintf(stderr, "Unknown record %d, stopping at call %zu\n", record, calls.size());
+            break;
+        }
+    }
+
+    if (reader.failed) fprintf(stderr, "Trace is truncated, replaying the %zu whole calls\n", calls.size());
+    return true;
+}
+
+static double percentile(const std::vector<uint64_t>& sorted, double p)
+{
+    if (sorted.empty()) return 0;
+    size_t index = std::min(sorted.size() - 1, (size_t)(p * (sorted.size() - 1) + 0.5));
+    return sorted[index] / 1000.0;
+}
+
+int main(int argc, char** argv)
+{
+    const char* tracePath = nullptr;
+    const char* modulePath = REPLAY_DEFAULT_MODULE;
+    int runs = 1;
+    int warmup = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+        if (option == "--module" && i + 1 < argc) modulePath = argv[++i];
+        else if (option == "--runs" && i + 1 < argc) runs = std::max(1, atoi(argv[++i]));
+        else if (option == "--warmup" && i + 1 < argc) warmup = std::max(0, atoi(argv[++i]));
+        else if (!tracePath && option[0] != '-') tracePath = argv[i];
+        else
+        {
+            tracePath = nullptr;
+            break;
+        }
+    }
+
+    if (!tracePath)
+    {
+        fprintf(stderr, "usage: gmsl-replay <trace> [--module path] [--runs n] [--warmup n]\n");
+        return 2;
+    }
+
+    std::vector<TraceMethod> methods;
+    std::vector<TraceCall> calls;
+    if (!read_trace(tracePath, methods, calls)) return 1;
+
+    const TraceReplayApi* api = load_module(modulePath);
+    if (!api)
+    {
+        fprintf(stderr, "Couldn't load interop_replay_api from %s\n", modulePath);
+        return 1;
+    }
+
+    YYRunnerInterface runner = replay_runner();
+    api->initialise(&runner, sizeof(runner));
+
+    // interop_set_function arguments, built once so the timed loop doesn't allocate
+    for (TraceMethod& method : methods)
+    {
+        replay_create_string(&method.names[0], method.dll.c_str());
+        replay_create_string(&method.names[1], method.ns.c_str());
+        replay_create_string(&method.names[2], method.clazz.c_str());
+        replay_create_string(&method.names[3], method.method.c_str());
+        method.names[4] = {};
+        method.names[4].kind = VALUE_REAL;
+        method.names[4].val = method.argc;
+    }
+
+    std::vector<MethodStats> stats(methods.size());
+    for (const TraceCall& call : calls)
+    {
+        MethodStats& stat = stats[call.method];
+        stat.calls++;
+        if (call.flags & TRACE_FAILED) stat.failed++;
+        stat.recorded.push_back(call.duration);
+        stat.replayed.reserve((size_t)stat.calls * runs);
+    }
+
+    for (int run = 0; run < warmup + runs; run++)
+    {
+        bool measured = run >= warmup;
+        for (TraceCall& call : calls)
+        {
+            RValue result{};
+            result.kind = VALUE_UNDEFINED;
+            api->setFunction(result, nullptr, nullptr, 5, methods[call.method].names);
+
+            auto start = std::chrono::steady_clock::now();
+            api->function(result, nullptr, nullptr, (int)call.args.size(), call.args.data());
+            auto end = std::chrono::steady_clock::now();
+
+            replay_free_rvalue(&result);
+            if (measured) stats[call.method].replayed.push_back((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+        }
+    }
+
+    printf("%zu calls, %zu methods, %d run(s) after %d warmup, times in us\n", calls.size(), methods.size(), runs, warmup);
+    printf("%-48s %8s %6s | %9s %9s | %9s %9s %9s %9s %9s %9s\n", "method", "calls", "failed", "rec p50", "rec p99",
+           "min", "p50", "p90", "p99", "max", "mean");
+
+    for (size_t i = 0; i < methods.size(); i++)
+    {
+        MethodStats& stat = stats[i];
+        if (stat.calls == 0) continue;
+
+        std::sort(stat.recorded.begin(), stat.recorded.end());
+        std::sort(stat.replayed.begin(), stat.replayed.end());
+
+        double total = 0;
+        for (uint64_t duration : stat.replayed) total += duration;
+
+        std::string name = methods[i].clazz + "." + methods[i].method;
+        if (name.size() > 48) name = "..." + name.substr(name.size() - 45);
+
+        printf("%-48s %8u %6u | %9.2f %9.2f | %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f\n", name.c_str(), stat.calls,
+               stat.failed, percentile(stat.recorded, 0.5), percentile(stat.recorded, 0.99),
+               percentile(stat.replayed, 0), percentile(stat.replayed, 0.5), percentile(stat.replayed, 0.9),
+               percentile(stat.replayed, 0.99), percentile(stat.replayed, 1), total / stat.replayed.size() / 1000.0);
+    }
+
+    for (TraceCall& call : calls)
+    {
+        for (RValue& arg : call.args) replay_free_rvalue(&arg);
+    }
+    for (TraceMethod& method : methods)
+    {
+        for (RValue& name : method.names) replay_free_rvalue(&name);
+    }
+
+    return 0;
+}
@@ -0,0 +1,453 @@
+// Checks the SSE2 and AVX2 buffer kernels against the scalar ones and times every level the cpu has. simd.cpp is
+// linked against a stand-in runner with plain heap buffers, so the GML entry points (range clamping included) run the
+// same way they do in game.
+//
+//   gmsl-simd-test [--size n] [--runs n]
+//
+// Inputs are small integers in every lane type, which keeps float sums and prefix sums exact whatever order a level
+// adds them in, so every level has to match the scalar results bit for bit. Exits with 1 on any mismatch.
+
+#include "extensions/Extension_Interface.h"
+#include "extensions/YYRValue.h"
+#include "simd.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+YYRunnerInterface* g_pYYRunnerInterface;
+
+// RefString::dec references these, the runner provides them in game
+void LOCK_RVALUE_MUTEX() {}
+void UNLOCK_RVALUE_MUTEX() {}
+
+YYEXPORT void interop_buffer_map(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg);
+YYEXPORT void interop_buffer_reduce(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg);
+YYEXPORT void interop_buffer_scan(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg);
+YYEXPORT void interop_buffer_filter(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg);
+YYEXPORT void interop_simd_level(RValue& Result, CInstance* selfinst, CInstance* otherinst, int argc, RValue* arg);
+
+#define GUARD 64
+#define GUARD_BYTE 0xA5
+
+static int failures = 0;
+
+#define CHECK(condition, ...)                   \
+    do                                          \
+    {                                           \
+        if (!(condition))                       \
+        {                                       \
+            failures++;                         \
+            fprintf(stderr, "FAIL: ");          \
+            fprintf(stderr, __VA_ARGS__);       \
+            fputc('\n', stderr);                \
+        }                                       \
+    } while (0)
+
+// stand-in runner, only what simd.cpp calls. A buffer is its bytes plus GUARD bytes past the end that the runner
+// doesn't report, so a kernel running past the buffer's size shows up as a changed guard
+
+struct TestBuffer
+{
+    std::vector<uint8_t> bytes;
+    int size;
+    int tell;
+};
+
+static std::vector<TestBuffer> buffers;
+
+static int test_buffer_create(int size, int tell)
+{
+    TestBuffer buffer;
+    buffer.bytes.assign(size + GUARD, GUARD_BYTE);
+    buffer.size = size;
+    buffer.tell = tell;
+    buffers.push_back(std::move(buffer));
+    return (int)buffers.size() - 1;
+}
+
+static bool test_buffer_guard_intact(int index)
+{
+    const TestBuffer& buffer = buffers[index];
+    for (int i = buffer.size; i < buffer.size + GUARD; i++)
+    {
+        if (buffer.bytes[i] != GUARD_BYTE) return false;
+    }
+    return true;
+}
+
+static IBuffer* test_buffer_get_from_gml(int index)
+{
+    return index >= 0 && index < (int)buffers.size() ? (IBuffer*)&buffers[index] : NULL;
+}
+
+static int test_buffer_tell(IBuffer* buffer)
+{
+    return ((TestBuffer*)buffer)->tell;
+}
+
+static unsigned char* test_buffer_get(IBuffer* buffer)
+{
+    return ((TestBuffer*)buffer)->bytes.data();
+}
+
+static double test_get_real(const RValue* base, int index)
+{
+    return base[index].val;
+}
+
+static int32_t test_get_int32(const RValue* base, int index)
+{
+    return (int32_t)base[index].val;
+}
+
+static const char* test_get_string(const RValue* base, int index)
+{
+    return base[index].GetString();
+}
+
+static YYRunnerInterface test_runner()
+{
+    YYRunnerInterface runner{};
+    runner.YYGetReal = test_get_real;
+    runner.YYGetInt32 = test_get_int32;
+    runner.YYGetString = test_get_string;
+    runner.BufferGetFromGML = test_buffer_get_from_gml;
+    runner.BufferTELL = test_buffer_tell;
+    runner.BufferGet = test_buffer_get;
+    return runner;
+}
+
+// GML call arguments, reals and strings only
+struct Args
+{
+    std::vector<RValue> values;
+
+    Args& real(double value)
+    {
+        RValue arg{};
+        arg.kind = VALUE_REAL;
+        arg.val = value;
+        values.push_back(arg);
+        return *this;
+    }
+
+    Args& string(const char* value)
+    {
+        RValue arg{};
+        arg.kind = VALUE_STRING;
+        arg.pRefString = new RefString(value);
+        values.push_back(arg);
+        return *this;
+    }
+
+    ~Args()
+    {
+        for (RValue& value : values)
+        {
+            if ((value.kind & MASK_KIND_RVALUE) == VALUE_STRING) value.pRefString->dec();
+        }
+    }
+};
+
+static double call(void (*function)(RValue&, CInstance*, CInstance*, int, RValue*), Args& args)
+{
+    RValue result{};
+    function(result, NULL, NULL, (int)args.values.size(), args.values.data());
+    return result.val;
+}
+
+// kernel checks against the scalar table
+
+static const char* levelNames[] = { "scalar", "sse2", "avx2" };
+static const char* laneNames[] = { "f32", "f64", "s32" };
+static const char* mapNames[] = { "add", "mul", "fma", "min", "max", "clamp", "abs" };
+static const char* reduceNames[] = { "sum", "min", "max" };
+static const char* cmpNames[] = { "<", "<=", ">", ">=", "==", "!=" };
+
+static const SimdKernels* level_kernels(int level)
+{
+#if SIMD_X86
+    if (level == SIMD_AVX2) return &simdAvx2;
+    if (level == SIMD_SSE2) return &simdSse2;
+#endif
+    return &simdScalar;
+}
+
+static size_t lane_size(SimdLane lane)
+{
+    return lane == SimdLane::F64 ? 8 : 4;
+}
+
+// count elements of small integers with GUARD bytes of pattern on either side, the kernels get the middle
+static std::vector<uint8_t> make_input(SimdLane lane, size_t count, std::mt19937& random)
+{
+    std::vector<uint8_t> bytes(count * lane_size(lane) + 2 * GUARD, GUARD_BYTE);
+    uint8_t* data = bytes.data() + GUARD;
+    std::uniform_int_distribution<int> value(-100, 100);
+    for (size_t i = 0; i < count; i++)
+    {
+        int x = value(random);
+        switch (lane)
+        {
+            case SimdLane::F32: ((float*)data)[i] = (float)x; break;
+            case SimdLane::F64: ((double*)data)[i] = (double)x; break;
+            case SimdLane::I32: ((int32_t*)data)[i] = x; break;
+        }
+    }
+    return bytes;
+}
+
+static bool guards_intact(const std::vector<uint8_t>& bytes)
+{
+    for (size_t i = 0; i < GUARD; i++)
+    {
+        if (bytes[i] != GUARD_BYTE || bytes[bytes.size() - 1 - i] != GUARD_BYTE) return false;
+    }
+    return true;
+}
+
+static void check_level(int level, const std::vector<size_t>& sizes)
+{
+    const SimdKernels& kernels = *level_kernels(level);
+    std::mt19937 random(level * 7919 + 1);
+
+    for (int l = 0; l < 3; l++)
+    {
+        SimdLane lane = (SimdLane)l;
+        size_t width = lane_size(lane);
+
+        for (size_t count : sizes)
+        {
+            std::vector<uint8_t> input = make_input(lane, count, random);
+
+            for (int op = 0; op <= (int)SimdMapOp::Abs; op++)
+            {
+                double a = op == (int)SimdMapOp::Clamp ? -20 : 3;
+                double b = op == (int)SimdMapOp::Clamp ? 30 : -7;
+                std::vector<uint8_t> expected = input, actual = input;
+                simdScalar.map(expected.data() + GUARD, count, lane, (SimdMapOp)op, a, b);
+                kernels.map(actual.data() + GUARD, count, lane, (SimdMapOp)op, a, b);
+                CHECK(actual == expected, "%s map %s %s n=%zu differs from scalar", levelNames[level], mapNames[op], laneNames[l], count);
+                CHECK(guards_intact(actual), "%s map %s %s n=%zu wrote outside its range", levelNames[level], mapNames[op], laneNames[l], count);
+            }
+
+            for (int op = 0; op <= (int)SimdReduceOp::Max; op++)
+            {
+                if (count == 0 && op != (int)SimdReduceOp::Sum) continue;
+                double expected = simdScalar.reduce(input.data() + GUARD, count, lane, (SimdReduceOp)op);
+                double actual = kernels.reduce(input.data() + GUARD, count, lane, (SimdReduceOp)op);
+                CHECK(actual == expected, "%s reduce %s %s n=%zu is %g, scalar %g", levelNames[level], reduceNames[op], laneNames[l], count, actual, expected);
+            }
+
+            {
+                std::vector<uint8_t> expected = input, actual = input;
+                simdScalar.scan(expected.data() + GUARD, count, lane);
+                kernels.scan(actual.data() + GUARD, count, lane);
+                CHECK(actual == expected, "%s scan %s n=%zu differs from scalar", levelNames[level], laneNames[l], count);
+                CHECK(guards_intact(actual), "%s scan %s n=%zu wrote outside its range", levelNames[level], laneNames[l], count);
+            }
+
+            for (int cmp = 0; cmp <= (int)SimdCmp::Ne; cmp++)
+            {
+                // anything past the kept elements is scratch, only those and the guards have to match
+                std::vector<uint8_t> expected = input, actual = input;
+                size_t expectedKept = simdScalar.filter(expected.data() + GUARD, count, lane, (SimdCmp)cmp, 5);
+                size_t actualKept = kernels.filter(actual.data() + GUARD, count, lane, (SimdCmp)cmp, 5);
+                CHECK(actualKept == expectedKept, "%s filter %s %s n=%zu kept %zu, scalar %zu", levelNames[level], cmpNames[cmp], laneNames[l], count, actualKept, expectedKept);
+                CHECK(actualKept == expectedKept && memcmp(actual.data() + GUARD, expected.data() + GUARD, expectedKept * width) == 0,
+                    "%s filter %s %s n=%zu kept different elements", levelNames[level], cmpNames[cmp], laneNames[l], count);
+                CHECK(guards_intact(actual), "%s filter %s %s n=%zu wrote outside its range", levelNames[level], cmpNames[cmp], laneNames[l], count);
+            }
+        }
+    }
+}
+
+// GML buffer_* type for each lane
+static const int laneTypes[] = { 8, 9, 6 };
+
+// the GML entry points have to keep every kernel inside the size they're given whatever offset and count they get
+static void check_ranges(int level)
+{
+    Args setLevel;
+    setLevel.real(level);
+    call(interop_simd_level, setLevel);
+
+    // 16 f32 lanes, tell past the end
+    int buffer = test_buffer_create(64, 1000);
+
+    Args map;
+    map.real(buffer).real(64).real(8).string("add").real(1).real(0).real(0).real(100000);
+    CHECK(call(interop_buffer_map, map) == 16, "%s map with a count past the end wasn't clamped", levelNames[level]);
+
+    Args scan;
+    scan.real(buffer).real(64).real(8).real(4).real(100000);
+    CHECK(call(interop_buffer_scan, scan) == 15, "%s scan with a count past the end wasn't clamped", levelNames[level]);
+
+    Args filter;
+    filter.real(buffer).real(64).real(8).string(">").real(-1000);
+    CHECK(call(interop_buffer_filter, filter) == 16, "%s filter with tell past the end wasn't clamped", levelNames[level]);
+
+    Args offset;
+    offset.real(buffer).real(64).real(8).string("mul").real(2).real(0).real(65);
+    CHECK(call(interop_buffer_map, offset) == -1, "%s map with an offset past the end ran", levelNames[level]);
+
+    Args end;
+    end.real(buffer).real(64).real(9).real(62).real(100000);
+    CHECK(call(interop_buffer_scan, end) == 0, "%s scan with less than a lane left ran", levelNames[level]);
+
+    Args negative;
+    negative.real(buffer).real(-1).real(8);
+    CHECK(call(interop_buffer_scan, negative) == -1, "%s scan with a negative size ran", levelNames[level]);
+
+    CHECK(test_buffer_guard_intact(buffer), "%s kernels wrote past the buffer's size", levelNames[level]);
+
+    // 8 f64 lanes of 1..8, the reduce from the second one with a count past the end has to stop at the last
+    int values = test_buffer_create(64, 64);
+    for (int i = 0; i < 8; i++) ((double*)buffers[values].bytes.data())[i] = i + 1;
+
+    Args sum;
+    sum.real(values).real(64).real(9).string("sum").real(8).real(100000);
+    double total = call(interop_buffer_reduce, sum);
+    CHECK(total == 35, "%s reduce sum with a count past the end is %g, expected 35", levelNames[level], total);
+
+    Args max;
+    max.real(values).real(32).real(9).string("max");
+    double largest = call(interop_buffer_reduce, max);
+    CHECK(largest == 4, "%s reduce max over a smaller size is %g, expected 4", levelNames[level], largest);
+}
+
+// timings over one buffer, every level starts from the same data. The kernels are timed on their own and through the
+// GML entry points, the difference is what a call from GML adds on top (argument parsing and the range checks)
+
+static double time_us(const std::chrono::steady_clock::time_point& start)
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void bench_level(int level, size_t size, int runs)
+{
+    const SimdKernels& kernels = *level_kernels(level);
+    std::mt19937 random(1);
+    volatile double sink = 0;
+
+    Args setLevel;
+    setLevel.real(level);
+    call(interop_simd_level, setLevel);
+
+    for (int l = 0; l < 3; l++)
+    {
+        SimdLane lane = (SimdLane)l;
+        std::vector<uint8_t> input = make_input(lane, size, random);
+        std::vector<uint8_t> work = input;
+        uint8_t* data = work.data() + GUARD;
+        double map = 0, reduce = 0, scan = 0, filter = 0;
+
+        for (int run = 0; run < runs; run++)
+        {
+            work = input;
+            auto start = std::chrono::steady_clock::now();
+            kernels.map(data, size, lane, SimdMapOp::Fma, 1, 1);
+            map += time_us(start);
+
+            start = std::chrono::steady_clock::now();
+            sink = sink + kernels.reduce(data, size, lane, SimdReduceOp::Sum);
+            reduce += time_us(start);
+
+            work = input;
+            start = std::chrono::steady_clock::now();
+            kernels.scan(data, size, lane);
+            scan += time_us(start);
+
+            work = input;
+            start = std::chrono::steady_clock::now();
+            sink = sink + (double)kernels.filter(data, size, lane, SimdCmp::Gt, 0);
+            filter += time_us(start);
+        }
+
+        printf("%-8s %-4s %-6s %10.1f %10.1f %10.1f %10.1f\n", levelNames[level], laneNames[l], "kernel", map / runs, reduce / runs, scan / runs, filter / runs);
+
+        // same runs through the entry points on a runner buffer, the argument lists are built once outside the timing
+        int bytes = (int)(size * lane_size(lane));
+        int buffer = test_buffer_create(bytes, bytes);
+        TestBuffer& target = buffers[buffer];
+        Args mapArgs, reduceArgs, scanArgs, filterArgs;
+        mapArgs.real(buffer).real(bytes).real(laneTypes[l]).string("fma").real(1).real(1);
+        reduceArgs.real(buffer).real(bytes).real(laneTypes[l]).string("sum");
+        scanArgs.real(buffer).real(bytes).real(laneTypes[l]);
+        filterArgs.real(buffer).real(bytes).real(laneTypes[l]).string(">").real(0);
+        map = reduce = scan = filter = 0;
+
+        for (int run = 0; run < runs; run++)
+        {
+            std::memcpy(target.bytes.data(), input.data() + GUARD, bytes);
+            auto start = std::chrono::steady_clock::now();
+            sink = sink + call(interop_buffer_map, mapArgs);
+            map += time_us(start);
+
+            start = std::chrono::steady_clock::now();
+            sink = sink + call(interop_buffer_reduce, reduceArgs);
+            reduce += time_us(start);
+
+            std::memcpy(target.bytes.data(), input.data() + GUARD, bytes);
+            start = std::chrono::steady_clock::now();
+            sink = sink + call(interop_buffer_scan, scanArgs);
+            scan += time_us(start);
+
+            std::memcpy(target.bytes.data(), input.data() + GUARD, bytes);
+            start = std::chrono::steady_clock::now();
+            sink = sink + call(interop_buffer_filter, filterArgs);
+            filter += time_us(start);
+        }
+
+        printf("%-8s %-4s %-6s %10.1f %10.1f %10.1f %10.1f\n", levelNames[level], laneNames[l], "gml", map / runs, reduce / runs, scan / runs, filter / runs);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    size_t size = 64 * 1024;
+    int runs = 200;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--size") == 0) size = (size_t)atoll(argv[i + 1]);
+        else if (strcmp(argv[i], "--runs") == 0) runs = atoi(argv[i + 1]);
+    }
+    if (runs < 1) runs = 1;
+
+    YYRunnerInterface runner = test_runner();
+    g_pYYRunnerInterface = &runner;
+
+    Args query;
+    query.real(SIMD_AVX2);
+    int supported = (int)call(interop_simd_level, query);
+
+    // every tail length for a few whole registers, then sizes around the unrolled loops
+    std::vector<size_t> sizes;
+    for (size_t count = 0; count <= 67; count++) sizes.push_back(count);
+    for (size_t count : { 127, 128, 129, 255, 256, 257, 1000, 1003 }) sizes.push_back(count);
+
+    for (int level = SIMD_SCALAR; level <= supported; level++)
+    {
+        check_level(level, sizes);
+        check_ranges(level);
+    }
+    if (supported < SIMD_AVX2) printf("%s isn't supported here, not checked\n", levelNames[supported + 1]);
+
+    printf("%zu elements, mean of %d runs in us\n", size, runs);
+    printf("%-8s %-4s %-6s %10s %10s %10s %10s\n", "level", "lane", "via", "map fma", "reduce sum", "scan", "filter >");
+    for (int level = SIMD_SCALAR; level <= supported; level++)
+    {
+        bench_level(level, size, runs);
+    }
+
+    if (failures)
+    {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}